@@ -0,0 +1,368 @@
+#include "Allocation.hpp"
+#include "SystemDefines.hpp"
+#include <cstdlib>
+#include <thread>
+#ifdef __linux__
+#include <sched.h> //sched_setaffinity()
+#include <sys/mman.h> //mmap(), madvise()
+#include <sys/syscall.h> //SYS_mbind, SYS_getcpu
+#include <unistd.h> //syscall()
+#endif
+
+static constexpr uint64_t PAGE_2M = UINT64_C(1) << 21;
+static constexpr uint64_t PAGE_1G = UINT64_C(1) << 30;
+
+static auto roundUp(const uint64_t bytes, const uint64_t pageSize) -> uint64_t { return (bytes + pageSize - 1) & ~(pageSize - 1); }
+
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
+/**
+ * Faults in the pages of a part of an allocation: [begin, end)
+ */
+static void prefaultPages(uint8_t *const begin, uint8_t *const end) {
+  static constexpr uintptr_t PAGE_4K = 4096;
+#ifdef __linux__
+  uint8_t *const first = reinterpret_cast<uint8_t *>(reinterpret_cast<uintptr_t>(begin) & ~(PAGE_4K - 1));
+  if( madvise(first, end - first, MADV_POPULATE_WRITE) == 0 ) {
+    return;
+  }
+#endif
+  // a page is faulted in by writing a byte of it (its own value: the allocation may be in use)
+  for( volatile uint8_t *p = begin; p < end; p = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(p) | (PAGE_4K - 1)) + 1) ) {
+    *p = *p;
+  }
+}
+
+void prefaultMemory(void *const address, const uint64_t bytes, const uint32_t threads) {
+  uint8_t *const begin = static_cast<uint8_t *>(address);
+  // the parts are multiples of 2 MB, so that a huge page is faulted in by a single thread
+  const uint64_t part = roundUp((bytes + threads - 1) / threads, PAGE_2M);
+  std::thread *workers = new std::thread[threads];
+  uint32_t started = 0;
+  for( uint64_t offset = part; offset < bytes; offset += part ) {
+    workers[started++] = std::thread(prefaultPages, begin + offset, begin + std::min(bytes, offset + part));
+  }
+  prefaultPages(begin, begin + std::min(bytes, part)); // the first part on this thread
+  for( uint32_t i = 0; i < started; i++ ) {
+    workers[i].join();
+  }
+  delete[] workers;
+}
+
+auto HeapAllocation::allocate(const uint64_t bytes, const uint64_t /*padding*/, MemoryBacking &backing) -> void * {
+  backing = MemoryBacking::Heap;
+  return calloc(bytes, 1);
+}
+
+void HeapAllocation::release(void *p, const uint64_t /*bytes*/, const uint64_t /*padding*/, const MemoryBacking /*backing*/) { free(p); }
+
+#ifdef __linux__
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/**
+ * @return true when transparent huge pages are not disabled ("never")
+ */
+static auto isThpEnabled() -> bool {
+  static const bool enabled = [] {
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "rb");
+    if( f == nullptr ) {
+      return false;
+    }
+    char s[64] = {};
+    const size_t n = fread(s, 1, sizeof(s) - 1, f);
+    fclose(f);
+    s[n] = 0;
+    return strstr(s, "[never]") == nullptr;
+  }();
+  return enabled;
+}
+
+/**
+ * Maps @ref size bytes at an address aligned to @ref alignment
+ */
+static auto mapAligned(const uint64_t size, const uint64_t alignment) -> uint8_t * {
+  void *p = mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if( p == MAP_FAILED ) {
+    return nullptr;
+  }
+  uint8_t *start = static_cast<uint8_t *>(p);
+  uint8_t *aligned = reinterpret_cast<uint8_t *>(roundUp(reinterpret_cast<uintptr_t>(start), alignment));
+  if( aligned != start ) {
+    munmap(start, aligned - start);
+  }
+  munmap(aligned + size, start + alignment - aligned);
+  return aligned;
+}
+
+static auto mappedSize(const uint64_t bytes, const MemoryBacking backing) -> uint64_t {
+  return roundUp(bytes, backing == MemoryBacking::HugePages1G ? PAGE_1G : PAGE_2M);
+}
+
+auto LargePageAllocation::allocate(const uint64_t bytes, const uint64_t padding, MemoryBacking &backing) -> void * {
+  const uint64_t size = bytes - padding; // mappings are page aligned
+  if( size < PAGE_2M ) {
+    return HeapAllocation::allocate(bytes, padding, backing);
+  }
+  if( size >= PAGE_1G ) {
+    void *p = mmap(nullptr, mappedSize(size, MemoryBacking::HugePages1G), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT), -1, 0);
+    if( p != MAP_FAILED ) {
+      backing = MemoryBacking::HugePages1G;
+      return p;
+    }
+  }
+  void *p = mmap(nullptr, mappedSize(size, MemoryBacking::HugePages2M), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+  if( p != MAP_FAILED ) {
+    backing = MemoryBacking::HugePages2M;
+    return p;
+  }
+  // no reserved huge pages: aligned to 2 MB so that all of it can be backed by transparent huge pages
+  uint8_t *mapped = mapAligned(mappedSize(size, MemoryBacking::Pages), PAGE_2M);
+  if( mapped == nullptr ) {
+    return HeapAllocation::allocate(bytes, padding, backing);
+  }
+  backing = isThpEnabled() && madvise(mapped, mappedSize(size, MemoryBacking::Pages), MADV_HUGEPAGE) == 0 ? MemoryBacking::TransparentHugePages
+                                                                                                          : MemoryBacking::Pages;
+  return mapped;
+}
+
+void LargePageAllocation::release(void *p, const uint64_t bytes, const uint64_t padding, const MemoryBacking backing) {
+  if( backing == MemoryBacking::Heap ) {
+    HeapAllocation::release(p, bytes, padding, backing);
+  } else if( p != nullptr ) {
+    munmap(p, mappedSize(bytes - padding, backing));
+  }
+}
+
+/**
+ * @return the number after @ref key in the "key value" lines of file @ref name (multiplied by @ref unit),
+ * or the number on the first line when @ref key is nullptr; UINT64_MAX when not found or "max" (no limit)
+ */
+static auto readValue(const char *name, const char *key, const uint64_t unit = 1) -> uint64_t {
+  FILE *f = fopen(name, "rb");
+  if( f == nullptr ) {
+    return UINT64_MAX;
+  }
+  uint64_t result = UINT64_MAX;
+  char line[256];
+  const size_t keyLength = key == nullptr ? 0 : strlen(key);
+  while( fgets(line, sizeof(line), f) != nullptr ) {
+    if( key == nullptr || (strncmp(line, key, keyLength) == 0 && (line[keyLength] == ' ' || line[keyLength] == ':')) ) {
+      unsigned long long value = 0;
+      if( sscanf(line + keyLength + (key == nullptr ? 0 : 1), " %llu", &value) == 1 ) {
+        result = value * unit;
+      }
+      break;
+    }
+  }
+  fclose(f);
+  return result;
+}
+
+/**
+ * @return the memory left by the limit of the memory cgroup of the process, UINT64_MAX when there is no limit.
+ * The reclaimable page cache (inactive files) is not counted as used.
+ * The cgroup is looked up by its path in /proc/self/cgroup, then at the root of the mounted hierarchy
+ * (in a container the cgroup of the process is usually the root of its namespace).
+ */
+static auto cgroupAvailableMemory() -> uint64_t {
+  char v1Path[256] = "", v2Path[256] = "";
+  FILE *f = fopen("/proc/self/cgroup", "rb");
+  if( f != nullptr ) {
+    char line[512];
+    while( fgets(line, sizeof(line), f) != nullptr ) {
+      line[strcspn(line, "\n")] = 0;
+      const char *controllers = strchr(line, ':');
+      const char *path = controllers == nullptr ? nullptr : strchr(controllers + 1, ':');
+      if( path == nullptr || strlen(path + 1) >= sizeof(v1Path) ) {
+        continue;
+      }
+      if( strncmp(line, "0::", 3) == 0 ) {
+        strcpy(v2Path, path + 1);
+      } else if( strncmp(controllers + 1, "memory:", 7) == 0 ) {
+        strcpy(v1Path, path + 1);
+      }
+    }
+    fclose(f);
+  }
+  struct Hierarchy {
+    const char *root, *path, *limit, *usage, *inactiveFile;
+  };
+  const Hierarchy hierarchies[] = {{"/sys/fs/cgroup", v2Path, "memory.max", "memory.current", "inactive_file"},
+                                   {"/sys/fs/cgroup/memory", v1Path, "memory.limit_in_bytes", "memory.usage_in_bytes", "total_inactive_file"}};
+  uint64_t available = UINT64_MAX;
+  for( const Hierarchy &h: hierarchies ) {
+    for( const char *path: {h.path, ""} ) {
+      char name[600];
+      snprintf(name, sizeof(name), "%s%s/%s", h.root, path, h.limit);
+      const uint64_t limit = readValue(name, nullptr);
+      if( limit == UINT64_MAX ) {
+        continue; // no such cgroup, or no limit
+      }
+      snprintf(name, sizeof(name), "%s%s/%s", h.root, path, h.usage);
+      uint64_t usage = readValue(name, nullptr);
+      snprintf(name, sizeof(name), "%s%s/memory.stat", h.root, path);
+      const uint64_t inactiveFile = readValue(name, h.inactiveFile);
+      if( usage == UINT64_MAX ) {
+        usage = 0;
+      }
+      if( inactiveFile != UINT64_MAX ) {
+        usage -= std::min(usage, inactiveFile);
+      }
+      if( limit < (UINT64_C(1) << 60) ) { // cgroup v1 reports no limit as a huge number
+        available = std::min(available, limit - std::min(limit, usage));
+      }
+      break;
+    }
+  }
+  return available;
+}
+
+/**
+ * Reads a list of numbers such as "0-3,8,10-11" (as in /sys/devices/system/node/online) from @ref name
+ * @return a bit for each number (up to 63), 0 when not found
+ */
+static auto readList(const char *name) -> uint64_t {
+  FILE *f = fopen(name, "rb");
+  if( f == nullptr ) {
+    return 0;
+  }
+  char s[4096] = {};
+  const size_t n = fread(s, 1, sizeof(s) - 1, f);
+  fclose(f);
+  s[n] = 0;
+  uint64_t result = 0;
+  for( const char *p = s; *p >= '0' && *p <= '9'; ) {
+    char *next;
+    const unsigned long first = strtoul(p, &next, 10);
+    unsigned long last = first;
+    if( *next == '-' ) {
+      last = strtoul(next + 1, &next, 10);
+    }
+    for( unsigned long i = first; i <= last && i < 64; i++ ) {
+      result |= UINT64_C(1) << i;
+    }
+    p = *next == ',' ? next + 1 : next;
+  }
+  return result;
+}
+
+/**
+ * @return a bit for each online NUMA node
+ */
+static auto numaNodes() -> uint64_t {
+  static const uint64_t nodes = readList("/sys/devices/system/node/online");
+  return nodes;
+}
+
+/**
+ * @return the node number of the @ref index th online node
+ */
+static auto numaNodeId(const uint32_t index) -> uint32_t {
+  uint64_t nodes = numaNodes();
+  for( uint32_t i = 0; i < index % numaNodeCount(); i++ ) {
+    nodes &= nodes - 1;
+  }
+  return nodes == 0 ? 0 : static_cast<uint32_t>(__builtin_ctzll(nodes));
+}
+
+auto numaNodeCount() -> uint32_t {
+  const uint32_t count = static_cast<uint32_t>(__builtin_popcountll(numaNodes()));
+  return count == 0 ? 1 : count;
+}
+
+auto numaCurrentNode() -> uint32_t {
+  unsigned cpu = 0, node = 0;
+  if( syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 ) {
+    return 0;
+  }
+  // the index of the node among the online nodes
+  return static_cast<uint32_t>(__builtin_popcountll(numaNodes() & ((UINT64_C(1) << node) - 1)));
+}
+
+auto numaPinThread(const uint32_t node) -> bool {
+  char name[64];
+  snprintf(name, sizeof(name), "/sys/devices/system/node/node%u/cpulist", numaNodeId(node));
+  FILE *f = fopen(name, "rb");
+  if( f == nullptr ) {
+    return false;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  char s[4096] = {};
+  const size_t n = fread(s, 1, sizeof(s) - 1, f);
+  fclose(f);
+  s[n] = 0;
+  for( const char *p = s; *p >= '0' && *p <= '9'; ) { // the same format as readList(), but with more than 64 CPUs
+    char *next;
+    const unsigned long first = strtoul(p, &next, 10);
+    unsigned long last = first;
+    if( *next == '-' ) {
+      last = strtoul(next + 1, &next, 10);
+    }
+    for( unsigned long i = first; i <= last && i < CPU_SETSIZE; i++ ) {
+      CPU_SET(i, &cpus);
+    }
+    p = *next == ',' ? next + 1 : next;
+  }
+  return CPU_COUNT(&cpus) != 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+void numaPlace(void *const address, const uint64_t bytes, const NumaPolicy policy, const uint32_t node) {
+  static constexpr int MPOL_BIND = 2;
+  static constexpr int MPOL_INTERLEAVE = 3;
+  if( policy == NumaPolicy::Default || numaNodeCount() < 2 ) {
+    return;
+  }
+  const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = reinterpret_cast<uintptr_t>(address) & ~(pageSize - 1);
+  const uint64_t nodeMask = policy == NumaPolicy::Local ? UINT64_C(1) << numaNodeId(node) : numaNodes();
+  // the mask has 64 bits: maxnode is one more than the highest node that can be given
+  syscall(SYS_mbind, start, reinterpret_cast<uintptr_t>(address) + bytes - start, policy == NumaPolicy::Local ? MPOL_BIND : MPOL_INTERLEAVE,
+          &nodeMask, 65, 0);
+}
+
+auto availableMemory() -> uint64_t {
+  const uint64_t available = std::min(readValue("/proc/meminfo", "MemAvailable", 1024), cgroupAvailableMemory());
+  return available == UINT64_MAX ? 0 : available;
+}
+
+#else
+
+auto LargePageAllocation::allocate(const uint64_t bytes, const uint64_t padding, MemoryBacking &backing) -> void * {
+  return HeapAllocation::allocate(bytes, padding, backing);
+}
+
+void LargePageAllocation::release(void *p, const uint64_t bytes, const uint64_t padding, const MemoryBacking backing) {
+  HeapAllocation::release(p, bytes, padding, backing);
+}
+
+auto numaNodeCount() -> uint32_t { return 1; }
+
+auto numaCurrentNode() -> uint32_t { return 0; }
+
+auto numaPinThread(const uint32_t /*node*/) -> bool { return false; }
+
+void numaPlace(void *const /*address*/, const uint64_t /*bytes*/, const NumaPolicy /*policy*/, const uint32_t /*node*/) {}
+
+#ifdef WINDOWS
+
+auto availableMemory() -> uint64_t {
+  MEMORYSTATUSEX status{};
+  status.dwLength = sizeof(status);
+  return GlobalMemoryStatusEx(&status) != 0 ? status.ullAvailPhys : 0;
+}
+
+#else
+
+auto availableMemory() -> uint64_t { return 0; }
+
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef PAQ8PX_ALLOCATION_HPP
+#define PAQ8PX_ALLOCATION_HPP
+
+#include <cstdint>
+
+/**
+ * The kind of memory behind an allocation (reported by @ref ProgramChecker)
+ */
+enum class MemoryBacking : uint8_t {
+  Heap, /**< calloc() */
+  Pages, /**< mapped with the default page size: huge pages were not available */
+  TransparentHugePages, /**< mapped and marked for transparent huge pages (MADV_HUGEPAGE) */
+  HugePages2M, /**< mapped on reserved 2 MB huge pages (MAP_HUGETLB) */
+  HugePages1G, /**< mapped on reserved 1 GB huge pages (MAP_HUGETLB) */
+  Count
+};
+
+/**
+ * The part of the program an allocation belongs to (itemized by @ref ProgramChecker and planned by @ref MemoryPlan)
+ */
+enum class MemoryComponent : uint8_t {
+  HashTable, /**< bit and byte histories of ContextMap2 */
+  Order2Map, /**< smOrder2 of NormalModel */
+  StateMaps, /**< the other StateMaps (smOrder0, smOrder1) */
+  Mixer, /**< inputs, weights, contexts and learning rates of the mixers */
+  InputBuffer, /**< the input buffer of Shared and the lookahead buffer of NormalModel */
+  Other, /**< file buffers, blocks, frames, strings */
+  Count
+};
+
+/**
+ * The bytes reserved by each component of a model (see Predictor::planMemory())
+ */
+struct MemoryPlan {
+  uint64_t mem {}; /**< ContextMap2 buckets (Shared::mem) */
+  uint64_t bytes[static_cast<int>(MemoryComponent::Count)] {};
+
+  void add(MemoryComponent component, uint64_t n) { bytes[static_cast<int>(component)] += n; }
+
+  [[nodiscard]] auto total() const -> uint64_t {
+    uint64_t sum = 0;
+    for( const uint64_t n: bytes ) {
+      sum += n;
+    }
+    return sum;
+  }
+};
+
+/**
+ * Allocation policies of @ref Array.
+ * allocate() returns zeroed memory (or nullptr when out of memory) and tells its backing, that is needed by release().
+ * @ref bytes includes @ref padding bytes that are needed for alignment only when the memory is not page aligned.
+ */
+struct HeapAllocation {
+    static auto allocate(uint64_t bytes, uint64_t padding, MemoryBacking &backing) -> void *;
+    static void release(void *p, uint64_t bytes, uint64_t padding, MemoryBacking backing);
+};
+
+/**
+ * For large tables with random access: huge pages make TLB misses rare.
+ * On Linux it tries 1 GB pages (for at least 1 GB) and 2 MB pages from the huge page pool reserved by
+ * the administrator (see /proc/sys/vm/nr_hugepages), then transparent huge pages.
+ * Allocations smaller than 2 MB and other systems use the heap.
+ */
+struct LargePageAllocation {
+    static auto allocate(uint64_t bytes, uint64_t padding, MemoryBacking &backing) -> void *;
+    static void release(void *p, uint64_t bytes, uint64_t padding, MemoryBacking backing);
+};
+
+/**
+ * Faults in the pages of @ref bytes bytes at @ref address with @ref threads threads (each a contiguous part),
+ * so that the coder doesn't stall on the first touch of each page. The content is not changed.
+ * On Linux the pages are populated by madvise(MADV_POPULATE_WRITE) (since 5.14), otherwise each page is written.
+ */
+void prefaultMemory(void *address, uint64_t bytes, uint32_t threads);
+
+/**
+ * Placement of the large tables of a model (the hash table and smOrder2) on the NUMA nodes (see -numa)
+ */
+enum class NumaPolicy : uint8_t {
+  Default, /**< the pages are placed by the system: usually on the node of the thread that touches them first */
+  Local, /**< bound to the node of the coder, and the coder is pinned to the CPUs of that node */
+  Interleave /**< interleaved across all the nodes: the coders are not pinned */
+};
+
+/**
+ * @return the number of online NUMA nodes (1 when not known, e.g. not on Linux)
+ */
+auto numaNodeCount() -> uint32_t;
+
+/**
+ * @return the NUMA node of the CPU the calling thread runs on (0 when not known)
+ */
+auto numaCurrentNode() -> uint32_t;
+
+/**
+ * Restricts the calling thread (and the threads it starts later) to the CPUs of NUMA node @ref node
+ * (the index among the online nodes)
+ * @return false when it's not possible
+ */
+auto numaPinThread(uint32_t node) -> bool;
+
+/**
+ * Sets the NUMA policy of the pages of @ref bytes bytes at @ref address, before they are touched:
+ * bound to node @ref node (NumaPolicy::Local) or interleaved across all the nodes (NumaPolicy::Interleave)
+ */
+void numaPlace(void *address, uint64_t bytes, NumaPolicy policy, uint32_t node);
+
+/**
+ * @return the memory (in bytes) that the process may still allocate without swapping or being killed: the lower of
+ * the available system memory (MemAvailable of /proc/meminfo on Linux) and the memory left by the limit of its
+ * cgroup (v1 or v2) on Linux, 0 when it's unknown
+ */
+auto availableMemory() -> uint64_t;
+
+#endif //PAQ8PX_ALLOCATION_HPP
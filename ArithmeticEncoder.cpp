@@ -3,16 +3,17 @@
 #include <cstdint>
 #include <cstdio>
 
-ArithmeticEncoder::ArithmeticEncoder(File* f) : x1(0), x2(0xffffffff), x(0), archive(f) {};
+ArithmeticEncoder::ArithmeticEncoder(File* f) : x1(0), x2(0xffffffff), x(0), archive(f), in(f), out(f) {};
 
 void ArithmeticEncoder::prefetch() {
   for (int i = 0; i < 4; ++i) {
-    x = (x << 8) + (archive->getchar() & 255);
+    x = (x << 8) + (in.getchar() & 255);
   }
 }
 
 void ArithmeticEncoder::flush() {
-  archive->putChar(x1 >> 24); // flush first unequal byte of range
+  out.putChar(x1 >> 24); // flush first unequal byte of range
+  out.flush();
 }
 
 void ArithmeticEncoder::encodeBit(int p, int bit) {
@@ -23,7 +24,7 @@ void ArithmeticEncoder::encodeBit(int p, int bit) {
   assert(xMid >= x1 && xMid < x2);
   bit != 0 ? (x2 = xMid) : (x1 = xMid + 1);
   while (((x1 ^ x2) & 0xFF000000) == 0) { // pass equal leading bytes of range
-    archive->putChar(x2 >> 24);
+    out.putChar(x2 >> 24);
     x1 <<= 8;
     x2 = (x2 << 8) + 255;
   }
@@ -39,7 +40,7 @@ int ArithmeticEncoder::decodeBit(int p) {
   while (((x1 ^ x2) & 0xFF000000) == 0) { // pass equal leading bytes of range
     x1 <<= 8;
     x2 = (x2 << 8) + 255;
-    x = (x << 8) + (archive->getchar() & 255); // EOF is OK
+    x = (x << 8) + (in.getchar() & 255); // EOF is OK
   }
   return bit;
 }
\ No newline at end of file
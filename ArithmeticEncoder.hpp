@@ -1,6 +1,8 @@
 #ifndef PAQ8PX_ARITHMETICENCODER_HPP
 #define PAQ8PX_ARITHMETICENCODER_HPP
 
+#include "file/BufferedReader.hpp"
+#include "file/BufferedWriter.hpp"
 #include "file/FileDisk.hpp"
 
 class ArithmeticEncoder {
@@ -9,6 +11,8 @@ public:
   uint32_t x1, x2; /**< Range, initially [0, 1), scaled by 2^32 */
   uint32_t x; /**< Decompress mode: last 4 input bytes of archive */
   File* archive; /**< Compressed data file */
+  BufferedReader in; /**< Decompress mode: reads the archive ahead */
+  BufferedWriter out; /**< Compress mode: collects the output until flush() */
 
   void prefetch();
   void flush();
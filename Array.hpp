@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
+#include "Allocation.hpp"
 #include "ProgramChecker.hpp"
 
 #ifdef NDEBUG
@@ -23,21 +24,26 @@ static void CHECK_INDEX(uint64_t index, uint64_t upperBound) {
 #endif
 
 /**
- * Array<T, Align> a(n); allocates memory for n elements of T.
+ * Array<T, Align, Allocation> a(n); allocates memory for n elements of T.
  * The base address is aligned if the "alignment" parameter is given.
+ * The memory is allocated by the Allocation policy (see Allocation.hpp), e.g. on huge pages for large tables,
+ * and it's reported to @ref ProgramChecker as part of a component.
  * Constructors for T are not called, the allocated memory is initialized to 0s.
  * It's the caller's responsibility to populate the array with elements.
  * Parameters are checked and indexing is bounds checked if assertions are on.
  * Use of copy and assignment constructors are not supported.
  * @tparam T
  * @tparam Align
+ * @tparam Allocation
  */
-template<class T, const int Align = 16>
+template<class T, const int Align = 16, class Allocation = HeapAllocation>
 class Array {
 private:
     uint64_t usedSize {};
     uint64_t reservedSize {};
     char *ptr {}; /**< Address of allocated memory (may not be aligned) */
+    MemoryBacking backing {}; /**< how ptr was allocated */
+    MemoryComponent component; /**< reported to @ref ProgramChecker */
     T *data;   /**< Aligned base address of the elements, (ptr <= T) */
     ProgramChecker *programChecker = ProgramChecker::getInstance();
     void create(uint64_t requestedSize);
@@ -54,7 +60,7 @@ private:
     auto operator=(Array const& /*unused*/) -> Array& { return *this; }
 
 public:
-    explicit Array(uint64_t requestedSize) { create(requestedSize); }
+    explicit Array(uint64_t requestedSize, MemoryComponent component = MemoryComponent::Other) : component(component) { create(requestedSize); }
 
     ~Array();
 
@@ -79,6 +85,24 @@ public:
      */
     void resize(uint64_t newSize);
 
+    /**
+     * Faults in the pages of the array with @ref threads threads (see prefaultMemory())
+     */
+    void prefault(const uint32_t threads) {
+      if( reservedSize != 0 ) {
+        prefaultMemory(data, reservedSize * sizeof(T), threads);
+      }
+    }
+
+    /**
+     * Places the pages of the array on the NUMA nodes (see numaPlace()), before they are touched
+     */
+    void place(const NumaPolicy policy, const uint32_t node) {
+      if( reservedSize != 0 ) {
+        numaPlace(data, reservedSize * sizeof(T), policy, node);
+      }
+    }
+
     /**
      * Removes the last element by reducing the size by one (but does not free memory).
      */
@@ -100,8 +124,8 @@ public:
 
 };
 
-template<class T, const int Align>
-void Array<T, Align>::create(uint64_t requestedSize) {
+template<class T, const int Align, class Allocation>
+void Array<T, Align, Allocation>::create(uint64_t requestedSize) {
 #ifdef VERBOSE
   printf("Created Array of size %" PRIu64 "\n", requestedSize);
 #endif
@@ -113,7 +137,7 @@ void Array<T, Align>::create(uint64_t requestedSize) {
     return;
   }
   const uint64_t bytesToAllocate = allocatedBytes();
-  ptr = (char *) calloc(bytesToAllocate, 1);
+  ptr = (char *) Allocation::allocate(bytesToAllocate, padding(), backing);
   if( ptr == nullptr ) {
     quit("Out of memory.");
   }
@@ -121,11 +145,12 @@ void Array<T, Align>::create(uint64_t requestedSize) {
   data = (T *) (((uintptr_t) ptr + pad) & ~(uintptr_t) pad);
   assert(ptr <= (char *) data && (char *) data <= ptr + Align);
   assert(((uintptr_t) data & (Align - 1)) == 0); //aligned as expected?
-  programChecker->alloc(bytesToAllocate);
+  programChecker->alloc(data, bytesToAllocate, component, reservedSize * sizeof(T));
+  programChecker->addBacking(backing, bytesToAllocate);
 }
 
-template<class T, const int Align>
-void Array<T, Align>::resize(uint64_t newSize) {
+template<class T, const int Align, class Allocation>
+void Array<T, Align, Allocation>::resize(uint64_t newSize) {
   if( newSize <= reservedSize ) {
     usedSize = newSize;
     return;
@@ -133,19 +158,21 @@ void Array<T, Align>::resize(uint64_t newSize) {
   char *oldPtr = ptr;
   T *oldData = data;
   const uint64_t oldSize = usedSize;
-  programChecker->free(allocatedBytes());
+  const uint64_t oldBytes = allocatedBytes();
+  const MemoryBacking oldBacking = backing;
+  programChecker->free(oldData, oldBytes, component);
   create(newSize);
   if( oldSize > 0 ) {
     assert(oldPtr != nullptr && oldData != nullptr);
     memcpy(data, oldData, sizeof(T) * oldSize);
   }
   if( oldPtr != nullptr ) {
-    free(oldPtr);
+    Allocation::release(oldPtr, oldBytes, padding(), oldBacking);
   }
 }
 
-template<class T, const int Align>
-void Array<T, Align>::pushBack(const T &x) {
+template<class T, const int Align, class Allocation>
+void Array<T, Align, Allocation>::pushBack(const T &x) {
   if( usedSize == reservedSize ) {
     const uint64_t oldSize = usedSize;
     const uint64_t newSize = usedSize * 2 + 16;
@@ -155,10 +182,10 @@ void Array<T, Align>::pushBack(const T &x) {
   data[usedSize++] = x;
 }
 
-template<class T, const int Align>
-Array<T, Align>::~Array() {
-  programChecker->free(allocatedBytes());
-  free(ptr);
+template<class T, const int Align, class Allocation>
+Array<T, Align, Allocation>::~Array() {
+  programChecker->free(data, allocatedBytes(), component);
+  Allocation::release(ptr, allocatedBytes(), padding(), backing);
   usedSize = reservedSize = 0;
   data = nullptr;
   ptr = nullptr;
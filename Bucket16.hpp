@@ -4,80 +4,162 @@
 #include <cstdint>
 #include <cstring>
 #include "HashElementForContextMap.hpp"
+#include "SIMDType.hpp"
+#include "Utils.hpp"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 /**
  * Hash bucket to be used in a hash table
- * A hash bucket consists of a list of HashElements
+ * A hash bucket consists of a list of hash elements
  * Each hash element consists of a 16-bit checksum for collision detection
- * and for ContextMap2: bit and byte statistics ( sizeof(HashElement) = 2+7 = 9 bytes )
- *
+ * and for ContextMap2: bit and byte statistics (2+7 = 9 bytes)
+ * The checksums are stored contiguously (followed by the statistics), so that they can be compared at once.
+ * The bucket fills a 64-byte cache line: 7*2 + 7*7 + 1 unused byte.
  */
 
-#pragma pack(push,1)
-template<typename T>
-struct HashElement {
-  uint16_t checksum;
-  T value;
-};
-#pragma pack(pop)
+#if (defined(__GNUC__) || defined(__clang__)) && (!defined(__ARM_FEATURE_SIMD32) && !defined(__ARM_NEON))
+__attribute__((target("sse2")))
+#endif
+/**
+ * @return 2 bits for each of the 8 checksums (the 8th is not part of the bucket): set when the checksum is @ref checksum or 0
+ */
+static inline auto matchOrEmptySse2(const uint16_t *const checksums, const uint16_t checksum) -> uint32_t {
+#if !defined(__i386__) && !defined(__x86_64__) && !defined(_M_X64)
+  return 0;
+#else
+  const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(checksums));
+  const __m128i match = _mm_cmpeq_epi16(c, _mm_set1_epi16(static_cast<short>(checksum)));
+  const __m128i empty = _mm_cmpeq_epi16(c, _mm_setzero_si128());
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(match, empty)));
+#endif
+}
 
 class Bucket16 {
 private:
   static constexpr int ElementsInBucket = 7;
-  HashElement<HashElementForContextMap> elements[ElementsInBucket];
+  uint16_t checksums[ElementsInBucket];
+  HashElementForContextMap values[ElementsInBucket];
   uint8_t unused{};
+
+  template<size_t n>
+  void shiftDown() {
+    memmove(&checksums[1], &checksums[0], n * sizeof(checksums[0]));
+    memmove(&values[1], &values[0], n * sizeof(values[0]));
+  }
+
+  /**
+   * Moves the first @ref i elements one slot down (freeing the first slot), overwriting element @ref i
+   */
+  void shiftDown(const size_t i) {
+    switch (i) { // with constant sizes the moves are inlined
+      case 1: shiftDown<1>(); break;
+      case 2: shiftDown<2>(); break;
+      case 3: shiftDown<3>(); break;
+      case 4: shiftDown<4>(); break;
+      case 5: shiftDown<5>(); break;
+      case 6: shiftDown<6>(); break;
+      default: break;
+    }
+  }
+
+  HashElementForContextMap* moveToFront(const size_t i, const uint16_t checksum) {
+    HashElementForContextMap value = values[i];
+    shiftDown(i);
+    checksums[0] = checksum;
+    values[0] = value;
+    return &values[0];
+  }
+
+  HashElementForContextMap* createInFront(const size_t i, const uint16_t checksum) {
+    shiftDown(i);
+    checksums[0] = checksum;
+    values[0] = {};
+    return &values[0];
+  }
+
 public:
 
   void reset() {
-    for (size_t i = 0; i < ElementsInBucket; i++)
-      elements[i] = {};
+    for (size_t i = 0; i < ElementsInBucket; i++) {
+      checksums[i] = 0;
+      values[i] = {};
+    }
   }
 
   void stat(uint64_t& used, uint64_t& empty) {
     for (size_t i = 0; i < ElementsInBucket; i++)
-      if (elements[i].checksum == 0)
+      if (checksums[i] == 0)
         empty++;
       else
         used++;
   }
 
+  /**
+   * @return the element with @ref checksum (without moving it), or nullptr when not found
+   */
+  const HashElementForContextMap* peek(uint16_t checksum) const {
+    checksum += checksum == 0;
+    for (size_t i = 0; i < ElementsInBucket; i++) {
+      if (checksums[i] == checksum)
+        return &values[i];
+    }
+    return nullptr;
+  }
+
+  /**
+   * Finds the element with @ref checksum and moves it to the first slot.
+   * When not found, a new element is created in the first slot in place of the first empty slot
+   * or (when there is no empty slot) the element with the lowest priority.
+   * The SIMD versions give the same result as SIMD_NONE.
+   */
+  template<SIMDType simd>
   HashElementForContextMap* find(uint16_t checksum) {
 
     checksum += checksum == 0; //don't allow 0 checksums (0 checksums are used for empty slots)
 
-    if (elements[0].checksum == checksum) //there is a high chance that we'll find it in the first slot, so go for it
-      return &elements[0].value;
+    if (checksums[0] == checksum) //there is a high chance that we'll find it in the first slot, so go for it
+      return &values[0];
+
+    if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3 || simd == SIMDType::SIMD_AVX2) {
+      // the first match or empty slot in slots 1..6 wins (the 7 checksums fit in a single 128-bit compare, AVX2 would not help)
+      const uint32_t found = matchOrEmptySse2(checksums, checksum) & 0x3ffcU;
+      if (found != 0) {
+        const size_t i = ilog2(found & (0U - found)) >> 1U; // the lowest set bit
+        return checksums[i] == checksum ? moveToFront(i, checksum) : createInFront(i, checksum);
+      }
+      // the bucket is full: replace the element with the lowest priority
+      uint8_t minPrio = 255;
+      size_t minElementIdx = 1;
+      for (size_t i = 1; i < ElementsInBucket; ++i) {
+        uint8_t thisPrio = values[i].prio();
+        if (thisPrio < minPrio) {
+          minPrio = thisPrio;
+          minElementIdx = i;
+        }
+      }
+      return createInFront(minElementIdx, checksum);
+    }
 
     uint8_t minPrio = 255;
     size_t minElementIdx = 1;
     for (size_t i = 1; i < ElementsInBucket; ++i) {
-      if (elements[i].checksum == checksum) { // found matching checksum
-        HashElementForContextMap value = elements[i].value;
-        //shift elements down
-        memmove(&elements[1], &elements[0], i * sizeof(HashElement<HashElementForContextMap>));
-        //move element to front (re-create)
-        elements[0].checksum = checksum;
-        elements[0].value = value;
-        return &elements[0].value;
+      if (checksums[i] == checksum) { // found matching checksum
+        return moveToFront(i, checksum);
       }
-      if (elements[i].checksum == 0) { // found empty slot
-        //shift elements down (free the first slot for the new element)
-        memmove(&elements[1], &elements[0], i * sizeof(HashElement<HashElementForContextMap>)); // i==0 is OK
-        goto create_element;
+      if (checksums[i] == 0) { // found empty slot
+        return createInFront(i, checksum); // free the first slot for the new element
       }
-      uint8_t thisPrio = elements[i].value.prio();
+      uint8_t thisPrio = values[i].prio();
       if (thisPrio < minPrio) { // "<" a little bit faster, sometimes even better
         minPrio = thisPrio;
         minElementIdx = i;
       }
     }
 
-    memmove(&elements[1], &elements[0], minElementIdx * sizeof(HashElement<HashElementForContextMap>));
-
-  create_element:
-    elements[0].checksum = checksum;
-    elements[0].value = {};
-    return &elements[0].value;
+    return createInFront(minElementIdx, checksum);
   }
 };
 
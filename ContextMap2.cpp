@@ -1,14 +1,212 @@
 #include "ContextMap2.hpp"
 
+/**
+ * @return log2 of the power of 2 @ref size (the hash table may have more than 2^32 buckets)
+ */
+static auto log2Of(const uint64_t size) -> int {
+  int bits = 0;
+  while( (UINT64_C(1) << bits) < size ) {
+    bits++;
+  }
+  return bits;
+}
+
 ContextMap2::ContextMap2(const Shared* const sh, const uint64_t size) :
   shared(sh),
-  hashTable(size),
+  hashTable(size, MemoryComponent::HashTable),
   runMap1{},
   stateMap1{},
-  mask(uint32_t(hashTable.size() - 1)), hashBits(ilog2(mask + 1)) {
+  mask(hashTable.size() - 1), hashBits(log2Of(size)) {
   assert(size >= 64 && isPowerOf2(size));
+  hashTable.place(shared->numaPolicy, shared->numaNode);
+  if( shared->prefaultThreads != 0 ) {
+    hashTable.prefault(shared->prefaultThreads);
+  }
+}
+
+template<SIMDType simd>
+ALWAYS_INLINE
+HashElementForContextMap* ContextMap2::findElement(const uint64_t index, const uint16_t checksum) {
+  if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3 || simd == SIMDType::SIMD_AVX2) {
+    return hashTable[index].find<SIMDType::SIMD_SSE2>(checksum);
+  }
+  return hashTable[index].find<SIMDType::SIMD_NONE>(checksum);
+}
+
+/**
+ * The mixer inputs of a context that depend only on its bit history state or its run state (for the SIMD versions of mix())
+ */
+struct ContextMap2MixTables {
+  int32_t bitInputs[256]; /**< the 2 inputs of a bit history state: the stretched one in the low, (p1 - 2048) >> 2 in the high 16 bits */
+  int32_t bitConfidence[256]; /**< 0: no bits seen, 1: the next bit is certain, 2: uncertain */
+  int32_t runInputs[1024]; /**< stretch(runMap1.p1(runState)) */
+};
+
+static auto getMixTables() -> const ContextMap2MixTables & {
+  static const ContextMap2MixTables tables = [] {
+    ContextMap2MixTables t {};
+    StateMap1 stateMap1;
+    RunMap1 runMap1;
+    for (int state = 1; state < 256; state++) { // state 0: all 0
+      const int p1 = stateMap1.p1(state);
+      const int contextIsYoung = int(state <= 6);
+      const int bitIsUncertain = int(StateTable::next(state, 2) != 0 && StateTable::next(state, 3) != 0);
+      t.bitInputs[state] = int32_t(uint32_t(uint16_t(stretch(p1) >> (contextIsYoung + 1))) | uint32_t((p1 - 2048) >> 2) << 16);
+      t.bitConfidence[state] = 1 + bitIsUncertain;
+    }
+    for (int runState = 0; runState < 1024; runState++) {
+      t.runInputs[runState] = stretch(runMap1.p1(runState));
+    }
+    return t;
+  }();
+  return tables;
+}
+
+/**
+ * The bit history state and the byte history of the contexts as 32-bit lanes
+ */
+struct ContextMap2Lanes {
+  alignas(32) int32_t state[ContextMap2::C];
+  alignas(32) int32_t byteState[ContextMap2::C];
+  alignas(32) int32_t runCount[ContextMap2::C];
+  alignas(32) int32_t byte1[ContextMap2::C];
+  alignas(32) int32_t byte2[ContextMap2::C];
+  alignas(32) int32_t byte3[ContextMap2::C];
+};
+
+static void writeInputs(short *const inputs, const int32_t *const runInputs, const int32_t *const bitInputs) {
+  for (uint32_t i = 0; i < ContextMap2::C; i++) {
+    inputs[i * 3] = short(runInputs[i]);
+    inputs[i * 3 + 1] = short(bitInputs[i]);
+    inputs[i * 3 + 2] = short(bitInputs[i] >> 16);
+  }
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (!defined(__ARM_FEATURE_SIMD32) && !defined(__ARM_NEON))
+__attribute__((target("avx2")))
+#endif
+static void mixLanesAvx2(const ContextMap2Lanes &lanes, const uint32_t bpos, const uint32_t c0, short *const inputs, int &order, uint32_t &confidence) {
+#if !defined(__i386__) && !defined(__x86_64__) && !defined(_M_X64)
+  return;
+#else
+  const ContextMap2MixTables &t = getMixTables();
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i offset = _mm256_set1_epi32(256);
+  const __m128i candidateShift = _mm_cvtsi32_si128(int(8 - bpos));
+  const __m128i bitShift = _mm_cvtsi32_si128(int(7 - bpos));
+  const __m256i vc0 = _mm256_set1_epi32(int(c0));
+
+  const __m256i state = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.state));
+  const __m256i byteState = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.byteState));
+  const __m256i runCount = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.runCount));
+  const __m256i byte1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.byte1));
+  const __m256i byte2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.byte2));
+  const __m256i byte3 = _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes.byte3));
+
+  // predict from bit context
+  const __m256i bitInputs = _mm256_i32gather_epi32(t.bitInputs, state, 4);
+  const __m256i bitConfidence = _mm256_i32gather_epi32(t.bitConfidence, state, 4);
+  const __m256i bitIsUncertain = _mm256_and_si256(_mm256_cmpeq_epi32(bitConfidence, _mm256_set1_epi32(2)), one);
+
+  // predict from last byte(s) in context
+  const __m256i complete1 = _mm256_cmpgt_epi32(byteState, _mm256_set1_epi32(bpos == 0 ? 0 : 2));
+  const __m256i complete2 = _mm256_cmpgt_epi32(byteState, _mm256_set1_epi32(bpos == 0 ? 2 : 6));
+  const __m256i match1 = _mm256_and_si256(complete1, _mm256_cmpeq_epi32(_mm256_srl_epi32(_mm256_add_epi32(byte1, offset), candidateShift), vc0));
+  const __m256i match2 = _mm256_andnot_si256(match1,
+    _mm256_and_si256(complete2, _mm256_cmpeq_epi32(_mm256_srl_epi32(_mm256_add_epi32(byte2, offset), candidateShift), vc0)));
+  const __m256i byte1IsUncertain = _mm256_andnot_si256(_mm256_cmpeq_epi32(byte2, byte1), one);
+  const __m256i byte2IsUncertain = _mm256_andnot_si256(_mm256_cmpeq_epi32(byte3, byte2), one);
+  const __m256i runState1 = _mm256_or_si256(_mm256_slli_epi32(runCount, 2), _mm256_or_si256(_mm256_slli_epi32(byte1IsUncertain, 1),
+    _mm256_and_si256(_mm256_srl_epi32(byte1, bitShift), one)));
+  const __m256i runState2 = _mm256_or_si256(_mm256_slli_epi32(bitIsUncertain, 1), _mm256_and_si256(_mm256_srl_epi32(byte2, bitShift), one));
+  const __m256i runState = _mm256_blendv_epi8(runState2, runState1, match1);
+  const __m256i runStretch = _mm256_mask_i32gather_epi32(zero, t.runInputs, runState, _mm256_or_si256(match1, match2), 4);
+  const __m256i runShift = _mm256_blendv_epi8(_mm256_add_epi32(byte2IsUncertain, one), byte1IsUncertain, match1);
+  const __m256i runInputs = _mm256_srav_epi32(runStretch, runShift);
+
+  alignas(32) int32_t runInputsOut[ContextMap2::C];
+  alignas(32) int32_t bitInputsOut[ContextMap2::C];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(runInputsOut), runInputs);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(bitInputsOut), bitInputs);
+  writeInputs(inputs, runInputsOut, bitInputsOut);
+
+  const uint32_t seen = ~uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(state, zero)))) & 0xffU;
+  order = 0;
+  for (uint32_t i = 0; i < ContextMap2::C; i++) {
+    order += int((seen >> i) & 1U);
+  }
+  // confidence is the base 3 number of the per context confidences, the first context is the most significant digit
+  __m256i sum = _mm256_mullo_epi32(bitConfidence, _mm256_setr_epi32(2187, 729, 243, 81, 27, 9, 3, 1));
+  __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  sum4 = _mm_add_epi32(sum4, _mm_srli_si128(sum4, 8));
+  sum4 = _mm_add_epi32(sum4, _mm_srli_si128(sum4, 4));
+  confidence = uint32_t(_mm_cvtsi128_si32(sum4));
+#endif
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (!defined(__ARM_FEATURE_SIMD32) && !defined(__ARM_NEON))
+__attribute__((target("sse2")))
+#endif
+static void mixLanesSse2(const ContextMap2Lanes &lanes, const uint32_t bpos, const uint32_t c0, short *const inputs, int &order, uint32_t &confidence) {
+#if !defined(__i386__) && !defined(__x86_64__) && !defined(_M_X64)
+  return;
+#else
+  // there are no gathers and no variable shifts: the table lookups are scalar, the shifts (0..2) are selected
+  const ContextMap2MixTables &t = getMixTables();
+  alignas(16) int32_t bitInputsOut[ContextMap2::C];
+  alignas(16) int32_t bitConfidence[ContextMap2::C];
+  order = 0;
+  confidence = 0;
+  for (uint32_t i = 0; i < ContextMap2::C; i++) {
+    bitInputsOut[i] = t.bitInputs[lanes.state[i]];
+    bitConfidence[i] = t.bitConfidence[lanes.state[i]];
+    order += int(lanes.state[i] != 0);
+    confidence = confidence * 3 + uint32_t(bitConfidence[i]);
+  }
+
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i offset = _mm_set1_epi32(256);
+  const __m128i candidateShift = _mm_cvtsi32_si128(int(8 - bpos));
+  const __m128i bitShift = _mm_cvtsi32_si128(int(7 - bpos));
+  const __m128i vc0 = _mm_set1_epi32(int(c0));
+  const __m128i threshold1 = _mm_set1_epi32(bpos == 0 ? 0 : 2);
+  const __m128i threshold2 = _mm_set1_epi32(bpos == 0 ? 2 : 6);
+  alignas(16) int32_t runState[ContextMap2::C];
+  alignas(16) int32_t runShift[ContextMap2::C];
+  alignas(16) int32_t runMatch[ContextMap2::C];
+  for (uint32_t i = 0; i < ContextMap2::C; i += 4) {
+    const __m128i byteState = _mm_load_si128(reinterpret_cast<const __m128i *>(&lanes.byteState[i]));
+    const __m128i runCount = _mm_load_si128(reinterpret_cast<const __m128i *>(&lanes.runCount[i]));
+    const __m128i byte1 = _mm_load_si128(reinterpret_cast<const __m128i *>(&lanes.byte1[i]));
+    const __m128i byte2 = _mm_load_si128(reinterpret_cast<const __m128i *>(&lanes.byte2[i]));
+    const __m128i byte3 = _mm_load_si128(reinterpret_cast<const __m128i *>(&lanes.byte3[i]));
+    const __m128i bitIsUncertain = _mm_and_si128(_mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i *>(&bitConfidence[i])), _mm_set1_epi32(2)), one);
+
+    const __m128i complete1 = _mm_cmpgt_epi32(byteState, threshold1);
+    const __m128i complete2 = _mm_cmpgt_epi32(byteState, threshold2);
+    const __m128i match1 = _mm_and_si128(complete1, _mm_cmpeq_epi32(_mm_srl_epi32(_mm_add_epi32(byte1, offset), candidateShift), vc0));
+    const __m128i match2 = _mm_andnot_si128(match1,
+      _mm_and_si128(complete2, _mm_cmpeq_epi32(_mm_srl_epi32(_mm_add_epi32(byte2, offset), candidateShift), vc0)));
+    const __m128i byte1IsUncertain = _mm_andnot_si128(_mm_cmpeq_epi32(byte2, byte1), one);
+    const __m128i byte2IsUncertain = _mm_andnot_si128(_mm_cmpeq_epi32(byte3, byte2), one);
+    const __m128i runState1 = _mm_or_si128(_mm_slli_epi32(runCount, 2), _mm_or_si128(_mm_slli_epi32(byte1IsUncertain, 1),
+      _mm_and_si128(_mm_srl_epi32(byte1, bitShift), one)));
+    const __m128i runState2 = _mm_or_si128(_mm_slli_epi32(bitIsUncertain, 1), _mm_and_si128(_mm_srl_epi32(byte2, bitShift), one));
+    _mm_store_si128(reinterpret_cast<__m128i *>(&runState[i]), _mm_or_si128(_mm_and_si128(match1, runState1), _mm_andnot_si128(match1, runState2)));
+    _mm_store_si128(reinterpret_cast<__m128i *>(&runShift[i]),
+      _mm_or_si128(_mm_and_si128(match1, byte1IsUncertain), _mm_andnot_si128(match1, _mm_add_epi32(byte2IsUncertain, one))));
+    _mm_store_si128(reinterpret_cast<__m128i *>(&runMatch[i]), _mm_or_si128(match1, match2));
+  }
+  alignas(16) int32_t runInputsOut[ContextMap2::C];
+  for (uint32_t i = 0; i < ContextMap2::C; i++) {
+    runInputsOut[i] = runMatch[i] != 0 ? t.runInputs[runState[i]] >> runShift[i] : 0;
+  }
+  writeInputs(inputs, runInputsOut, bitInputsOut);
+#endif
 }
 
+
 void ContextMap2::updatePendingContextsInSlot(HashElementForContextMap* const p, uint32_t c) {
   // in case of a collision updating (mixing) is slightly better (but slightly slower) then resetting, so we update
   StateTable::update(&p->bitState, (c >> 2) & 1);
@@ -16,42 +214,88 @@ void ContextMap2::updatePendingContextsInSlot(HashElementForContextMap* const p,
   StateTable::update(&p->bitStates.bitState00 + ((c >> 1) & 3), c & 1);
 }
 
-void ContextMap2::updatePendingContexts(uint32_t ctx, uint16_t checksum, uint32_t c) {
+template<SIMDType simd>
+void ContextMap2::updatePendingContexts(uint64_t ctx, uint16_t checksum, uint32_t c) {
   // update pending bit histories for bits 2, 3, 4
-  HashElementForContextMap* const p1A = hashTable[(ctx + (c >> 6)) & mask].find(checksum);
+  HashElementForContextMap* const p1A = findElement<simd>((ctx + (c >> 6)) & mask, checksum);
   updatePendingContextsInSlot(p1A, c >> 3);
   // update pending bit histories for bits 5, 6, 7
-  HashElementForContextMap* const p1B = hashTable[(ctx + (c >> 3)) & mask].find(checksum);
+  HashElementForContextMap* const p1B = findElement<simd>((ctx + (c >> 3)) & mask, checksum);
   updatePendingContextsInSlot(p1B, c);
 }
 
+void ContextMap2::prefetchPendingContexts(const uint64_t ctx, const HashElementForContextMap* const slot0) {
+  // the buckets of the bit histories of the last 2 or 3 bytes (see set())
+  if (slot0->bitState > 6 && slot0->bitState <= 14) {
+    const uint32_t bytes[3] = {slot0->byteStats.byte1 + 256u, slot0->byteStats.byte2 + 256u, slot0->byteStats.byte3 + 256u};
+    for (uint32_t c : bytes) {
+      PREFETCH(&hashTable[(ctx + (c >> 6)) & mask]);
+      PREFETCH(&hashTable[(ctx + (c >> 3)) & mask]);
+    }
+  }
+}
+
 void ContextMap2::set(const int index, const uint64_t contexthash) { //set per index
+  set(index, getTableIndex(contexthash), getTableChecksum(contexthash));
+}
+
+void ContextMap2::set(const int index, const uint64_t tableIndex, const uint16_t tableChecksum) {
   assert(index >= 0 && index < C);
   ContextInfo *contextInfo = &contextInfoList[index];
-  const uint32_t ctx = contextInfo->tableIndex = finalize64(contexthash, hashBits);
-  const uint16_t chk = contextInfo->tableChecksum = checksum16(contexthash, hashBits);
-  HashElementForContextMap* const slot0 =  hashTable[ctx].find(chk);
-  contextInfo->slot0 = slot0;
-  contextInfo->slot012 = slot0;
-
-  uint8_t ctxflags = 0;
-  if (slot0->bitState <= 6) { // while constructing statistics for the first 3 bytes (states: 0; 1-2; 3-6) defer updating bit statistics in slot1 and slot2
-    ctxflags |= FLAG_DEFERRED_UPDATE;
-  }
-  else if (slot0->bitState <= 14) { // the first 3 bytes in this context are now known, it's time to update pending bit histories
-    if (slot0->byteStats.runcount == 2) {
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte2 + 256);
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte1 + 256);
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte1 + 256);
+  contextInfo->tableIndex = tableIndex;
+  contextInfo->tableChecksum = tableChecksum;
+  PREFETCH(&hashTable[tableIndex]);
+  contextsSet = true;
+}
+
+void ContextMap2::prefetch(const uint64_t tableIndex, const uint8_t c) {
+  const uint32_t c8 = c + 256u;
+  PREFETCH(&hashTable[tableIndex]);
+  PREFETCH(&hashTable[(tableIndex + (c8 >> 6)) & mask]); // c0 at bit 2
+  PREFETCH(&hashTable[(tableIndex + (c8 >> 3)) & mask]); // c0 at bit 5
+}
+
+template<SIMDType simd>
+void ContextMap2::probeContexts() {
+  // the contexts are probed in order as if each was probed by its set(): the result doesn't depend on the prefetching
+  for (uint32_t i = 0; i < C; i++) {
+    if (PREFETCH_DISTANCE != 0 && i + PREFETCH_DISTANCE < C) { // its bucket was prefetched by set(), it has probably arrived
+      const ContextInfo *ahead = &contextInfoList[i + PREFETCH_DISTANCE];
+      const HashElementForContextMap* const slot0Ahead = hashTable[ahead->tableIndex].peek(ahead->tableChecksum);
+      if (slot0Ahead != nullptr) {
+        prefetchPendingContexts(ahead->tableIndex, slot0Ahead);
+      }
     }
-    else {
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte3 + 256);
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte2 + 256);
-      updatePendingContexts(ctx, chk, slot0->byteStats.byte1 + 256);
+    ContextInfo *contextInfo = &contextInfoList[i];
+    const uint64_t ctx = contextInfo->tableIndex;
+    const uint16_t chk = contextInfo->tableChecksum;
+    HashElementForContextMap* const slot0 = findElement<simd>(ctx, chk);
+    contextInfo->slot0 = slot0;
+    contextInfo->slot012 = slot0;
+
+    uint8_t ctxflags = 0;
+    if (slot0->bitState <= 6) { // while constructing statistics for the first 3 bytes (states: 0; 1-2; 3-6) defer updating bit statistics in slot1 and slot2
+      ctxflags |= FLAG_DEFERRED_UPDATE;
     }
+    else if (slot0->bitState <= 14) { // the first 3 bytes in this context are now known, it's time to update pending bit histories
+      if (i < PREFETCH_DISTANCE || PREFETCH_DISTANCE == 0) { // not prefetched ahead
+        prefetchPendingContexts(ctx, slot0);
+      }
+      if (slot0->byteStats.runcount == 2) {
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte2 + 256);
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte1 + 256);
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte1 + 256);
+      }
+      else {
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte3 + 256);
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte2 + 256);
+        updatePendingContexts<simd>(ctx, chk, slot0->byteStats.byte1 + 256);
+      }
+    }
+
+    contextInfo->flags = ctxflags;
   }
-  
-  contextInfo->flags = ctxflags;
+  contextsSet = false;
 }
 
 
@@ -96,140 +340,219 @@ size_t ContextMap2::getStateByteLocation(const uint32_t bpos, const uint32_t c0)
 }
 
 
-void ContextMap2::update() {
+template<SIMDType simd>
+ALWAYS_INLINE
+void ContextMap2::updateContext(ContextInfo* const contextInfo, const uint8_t y, const uint8_t bpos, const uint8_t c1, const uint8_t c0) {
+  const uint8_t flags = contextInfo->flags;
 
-  INJECT_SHARED_y
-  INJECT_SHARED_bpos
-  INJECT_SHARED_c1
-  INJECT_SHARED_c0
-  for( uint32_t i = 0; i < C; i++ ) {
-    ContextInfo* contextInfo = &contextInfoList[i];
-    const uint8_t flags = contextInfo->flags;
-
-    uint8_t* pState = &contextInfo->slot012->bitState + getStateByteLocation((bpos - 1) & 7, (bpos == 0 ? c1 + 256u : c0) >> 1);
-    StateTable::update(pState, y);
-      
-    assume(bpos >= 0 && bpos <= 7);
-    if (bpos == 0) {
-      // update byte history and run statistics
-      if (contextInfo->slot0->bitState < 3) {
-        contextInfo->slot0->byteStats.byte3 = contextInfo->slot0->byteStats.byte2 = contextInfo->slot0->byteStats.byte1 = c1;
-        contextInfo->slot0->byteStats.runcount = 1;
+  uint8_t* pState = &contextInfo->slot012->bitState + getStateByteLocation((bpos - 1) & 7, (bpos == 0 ? c1 + 256u : c0) >> 1);
+  StateTable::update(pState, y);
+    
+  assume(bpos >= 0 && bpos <= 7);
+  if (bpos == 0) {
+    // update byte history and run statistics
+    if (contextInfo->slot0->bitState < 3) {
+      contextInfo->slot0->byteStats.byte3 = contextInfo->slot0->byteStats.byte2 = contextInfo->slot0->byteStats.byte1 = c1;
+      contextInfo->slot0->byteStats.runcount = 1;
+    }
+    else {
+      const bool isMatch = contextInfo->slot0->byteStats.byte1 == c1;
+      if (isMatch) {
+        uint8_t runCount = contextInfo->slot0->byteStats.runcount;
+        if (runCount < 255) {
+          contextInfo->slot0->byteStats.runcount = runCount + 1;
+        }
       }
       else {
-        const bool isMatch = contextInfo->slot0->byteStats.byte1 == c1;
-        if (isMatch) {
-          uint8_t runCount = contextInfo->slot0->byteStats.runcount;
-          if (runCount < 255) {
-            contextInfo->slot0->byteStats.runcount = runCount + 1;
-          }
+        // shift byte candidates
+        contextInfo->slot0->byteStats.runcount = 1;
+        contextInfo->slot0->byteStats.byte3 = contextInfo->slot0->byteStats.byte2;
+        contextInfo->slot0->byteStats.byte2 = contextInfo->slot0->byteStats.byte1;
+        contextInfo->slot0->byteStats.byte1 = c1; //last byte seen
+      }
+    }
+  }
+  else if( bpos==2 || bpos==5 ) {
+    if (flags & FLAG_DEFERRED_UPDATE) { //when in deferred mode...
+      // ...reconstruct bit states in temporary location from last seen bytes 
+
+      memset(&contextInfo->bitStateTmp, 0, 7);
+      contextInfo->slot012 = &contextInfo->bitStateTmp;
+        
+      const uint8_t bit0state = contextInfo->slot0->bitState;
+      if (bit0state >= 3) { // at least 1 byte was seen
+        const uint8_t byte2 = bit0state >= 7 ? contextInfo->slot0->byteStats.byte2 : contextInfo->slot0->byteStats.byte1;
+        const uint8_t mask = ((1 << bpos) - 1);
+        const int shift = 8 - bpos;
+        if (((c0 ^ (byte2 >> shift)) & mask) == 0) { // last 2/5 bits must match otherwise it's not the current slot location
+          updatePendingContextsInSlot(&contextInfo->bitStateTmp, byte2 >> (shift - 3)); // simulate the current states at the temporary location
         }
-        else {
-          // shift byte candidates
-          contextInfo->slot0->byteStats.runcount = 1;
-          contextInfo->slot0->byteStats.byte3 = contextInfo->slot0->byteStats.byte2;
-          contextInfo->slot0->byteStats.byte2 = contextInfo->slot0->byteStats.byte1;
-          contextInfo->slot0->byteStats.byte1 = c1; //last byte seen
+        if (bit0state >= 7) { // at least 2 bytes were seen
+          const uint8_t byte1 = contextInfo->slot0->byteStats.byte1;
+          if (((c0 ^ (byte1 >> shift)) & mask) == 0) { // last 2/5 bits must match otherwise it's not the current slot location
+            updatePendingContextsInSlot(&contextInfo->bitStateTmp, byte1 >> (shift - 3)); // simulate the current states at the temporary location
+          }
         }
       }
     }
-    else if( bpos==2 || bpos==5 ) {
-      if (flags & FLAG_DEFERRED_UPDATE) { //when in deferred mode...
-        // ...reconstruct bit states in temporary location from last seen bytes 
-
-        memset(&contextInfo->bitStateTmp, 0, 7);
-        contextInfo->slot012 = &contextInfo->bitStateTmp;
-          
-        const uint8_t bit0state = contextInfo->slot0->bitState;
-        if (bit0state >= 3) { // at least 1 byte was seen
-          const uint8_t byte2 = bit0state >= 7 ? contextInfo->slot0->byteStats.byte2 : contextInfo->slot0->byteStats.byte1;
-          const uint8_t mask = ((1 << bpos) - 1);
-          const int shift = 8 - bpos;
-          if (((c0 ^ (byte2 >> shift)) & mask) == 0) { // last 2/5 bits must match otherwise it's not the current slot location
-            updatePendingContextsInSlot(&contextInfo->bitStateTmp, byte2 >> (shift - 3)); // simulate the current states at the temporary location
-          }
-          if (bit0state >= 7) { // at least 2 bytes were seen
-            const uint8_t byte1 = contextInfo->slot0->byteStats.byte1;
-            if (((c0 ^ (byte1 >> shift)) & mask) == 0) { // last 2/5 bits must match otherwise it's not the current slot location
-              updatePendingContextsInSlot(&contextInfo->bitStateTmp, byte1 >> (shift - 3)); // simulate the current states at the temporary location
-            }
-          }
+    else {
+      //when pbos==2: switch from slot 0 to slot 1
+      //when bpos==5: switch from slot 1 to slot 2
+      const uint64_t ctx = contextInfo->tableIndex;
+      const uint16_t chk = contextInfo->tableChecksum;
+      contextInfo->slot012 = findElement<simd>((ctx + c0) & mask, chk);
+    }
+  }
+}
+
+ALWAYS_INLINE
+void ContextMap2::mixContext(Mixer &m, ContextInfo* const contextInfo, const uint8_t bpos, const uint8_t c0) {
+  uint8_t* pState = &contextInfo->slot012->bitState + getStateByteLocation(bpos, c0);
+  const int state = *pState;
+  const int n0 = StateTable::next(state, 2);
+  const int n1 = StateTable::next(state, 3);
+  const int bitIsUncertain = int(n0 != 0 && n1 != 0);
+
+  // predict from last byte(s) in context
+  uint8_t byteState = contextInfo->slot0->bitState;
+  const bool complete1 = (byteState >= 3) || (byteState >= 1 && bpos == 0);
+  const bool complete2 = (byteState >= 7) || (byteState >= 3 && bpos == 0);
+
+  bool skippedRunMap = true;
+  if( complete1 ) {
+    if(((contextInfo->slot0->byteStats.byte1 + 256u) >> (8 - bpos)) == c0 ) { // 1st candidate (last byte seen) matches
+      const int predictedBit = (contextInfo->slot0->byteStats.byte1 >> (7 - bpos)) & 1;
+      const int byte1IsUncertain = static_cast<const int>(contextInfo->slot0->byteStats.byte2 != contextInfo->slot0->byteStats.byte1);
+      const int runCount = contextInfo->slot0->byteStats.runcount; // 1..255
+      m.add(stretch(runMap1.p1(runCount << 2 | byte1IsUncertain << 1 | predictedBit)) >> (byte1IsUncertain));
+      skippedRunMap = false;
+    } else if( complete2 && ((contextInfo->slot0->byteStats.byte2 + 256u) >> (8 - bpos)) == c0 ) { // 2nd candidate matches
+      const int predictedBit = (contextInfo->slot0->byteStats.byte2 >> (7 - bpos)) & 1;
+      const int byte2IsUncertain = static_cast<const int>(contextInfo->slot0->byteStats.byte3 != contextInfo->slot0->byteStats.byte2);
+      m.add(stretch(runMap1.p1(bitIsUncertain << 1 | predictedBit)) >> (1 + byte2IsUncertain));
+      skippedRunMap = false;
+    }
+  }
+  if(skippedRunMap) {
+    m.add(0);
+  }
+
+  // predict from bit context
+  confidence *= 3;
+  if( state == 0 ) {
+    m.add(0);
+    m.add(0);
+  } else {
+    const int p1 = stateMap1.p1(state);
+    const int st = stretch(p1);
+    const int contextIsYoung = int(state <= 6);
+    m.add(st >> (contextIsYoung + 1));
+    m.add((p1 - 2048) >> 2);
+    order++;
+    confidence += 1 + bitIsUncertain;
+  }
+}
+
+template<SIMDType simd>
+void ContextMap2::update() {
+
+  INJECT_SHARED_y
+  INJECT_SHARED_bpos
+  INJECT_SHARED_c1
+  INJECT_SHARED_c0
+  if (shared->speculativePrefetch) {
+    if (bpos == 1 || bpos == 4) { // the next slot is at (ctx + c0) at bpos 2 or 5: prefetch it for both values of the next bit
+      for (uint32_t i = 0; i < C; i++) {
+        if ((contextInfoList[i].flags & FLAG_DEFERRED_UPDATE) == 0) {
+          const uint64_t ctx = contextInfoList[i].tableIndex + c0 * 2;
+          PREFETCH(&hashTable[ctx & mask]);
+          PREFETCH(&hashTable[(ctx + 1) & mask]);
         }
       }
-      else {
-        //when pbos==2: switch from slot 0 to slot 1
-        //when bpos==5: switch from slot 1 to slot 2
-        const uint32_t ctx = contextInfo->tableIndex;
-        const uint16_t chk = contextInfo->tableChecksum;
-        contextInfo->slot012 = hashTable[(ctx + c0) & mask].find(chk);
+    }
+  }
+  else if (bpos == 2 || bpos == 5) { // the buckets of the next slots are probed below: let their cache misses overlap
+    for (uint32_t i = 0; i < C; i++) {
+      if ((contextInfoList[i].flags & FLAG_DEFERRED_UPDATE) == 0) {
+        PREFETCH(&hashTable[(contextInfoList[i].tableIndex + c0) & mask]);
       }
     }
   }
+  for( uint32_t i = 0; i < C; i++ ) {
+    updateContext<simd>(&contextInfoList[i], y, bpos, c1, c0);
+  }
 }
 
+template<SIMDType simd>
 void ContextMap2::mix(Mixer &m) {
 
+  if (contextsSet) {
+    probeContexts<simd>();
+  }
+
   order = 0;
   confidence = 0;
 
   INJECT_SHARED_bpos
   INJECT_SHARED_c0
+  if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3 || simd == SIMDType::SIMD_AVX2) {
+    mixContextsSimd<simd>(m, bpos, c0);
+    return;
+  }
   for( uint32_t i = 0; i < C; i++ ) {
-    ContextInfo* contextInfo = &contextInfoList[i];
-    uint8_t* pState = &contextInfo->slot012->bitState + getStateByteLocation(bpos, c0);
-    const int state = *pState;
-    const int n0 = StateTable::next(state, 2);
-    const int n1 = StateTable::next(state, 3);
-    const int bitIsUncertain = int(n0 != 0 && n1 != 0);
-
-    // predict from last byte(s) in context
-    uint8_t byteState = contextInfo->slot0->bitState;
-    const bool complete1 = (byteState >= 3) || (byteState >= 1 && bpos == 0);
-    const bool complete2 = (byteState >= 7) || (byteState >= 3 && bpos == 0);
-
-    bool skippedRunMap = true;
-    if( complete1 ) {
-      if(((contextInfo->slot0->byteStats.byte1 + 256u) >> (8 - bpos)) == c0 ) { // 1st candidate (last byte seen) matches
-        const int predictedBit = (contextInfo->slot0->byteStats.byte1 >> (7 - bpos)) & 1;
-        const int byte1IsUncertain = static_cast<const int>(contextInfo->slot0->byteStats.byte2 != contextInfo->slot0->byteStats.byte1);
-        const int runCount = contextInfo->slot0->byteStats.runcount; // 1..255
-        m.add(stretch(runMap1.p1(runCount << 2 | byte1IsUncertain << 1 | predictedBit)) >> (byte1IsUncertain));
-        skippedRunMap = false;
-      } else if( complete2 && ((contextInfo->slot0->byteStats.byte2 + 256u) >> (8 - bpos)) == c0 ) { // 2nd candidate matches
-        const int predictedBit = (contextInfo->slot0->byteStats.byte2 >> (7 - bpos)) & 1;
-        const int byte2IsUncertain = static_cast<const int>(contextInfo->slot0->byteStats.byte3 != contextInfo->slot0->byteStats.byte2);
-        m.add(stretch(runMap1.p1(bitIsUncertain << 1 | predictedBit)) >> (1 + byte2IsUncertain));
-        skippedRunMap = false;
-      }
-    }
-    if(skippedRunMap) {
-      m.add(0);
-    }
+    mixContext(m, &contextInfoList[i], bpos, c0);
+  }
+}
 
-    // predict from bit context
-    confidence *= 3;
-    if( state == 0 ) {
-      m.add(0);
-      m.add(0);
-    } else {
-      const int p1 = stateMap1.p1(state);
-      const int st = stretch(p1);
-      const int contextIsYoung = int(state <= 6);
-      m.add(st >> (contextIsYoung + 1));
-      m.add((p1 - 2048) >> 2);
-      order++;
-      confidence += 1 + bitIsUncertain;
-    }
+template<SIMDType simd>
+void ContextMap2::mixContextsSimd(Mixer &m, const uint8_t bpos, const uint8_t c0) {
+  ContextMap2Lanes lanes;
+  for (uint32_t i = 0; i < C; i++) {
+    const ContextInfo* const contextInfo = &contextInfoList[i];
+    const HashElementForContextMap* const slot0 = contextInfo->slot0;
+    lanes.state[i] = *(&contextInfo->slot012->bitState + getStateByteLocation(bpos, c0));
+    lanes.byteState[i] = slot0->bitState;
+    lanes.runCount[i] = slot0->byteStats.runcount;
+    lanes.byte1[i] = slot0->byteStats.byte1;
+    lanes.byte2[i] = slot0->byteStats.byte2;
+    lanes.byte3[i] = slot0->byteStats.byte3;
   }
+  short* const inputs = m.addInputs(C * MIXERINPUTS);
+  if (simd == SIMDType::SIMD_AVX2) {
+    mixLanesAvx2(lanes, bpos, c0, inputs, order, confidence);
+  }
+  else {
+    mixLanesSse2(lanes, bpos, c0, inputs, order, confidence);
+  }
+}
+
+void ContextMap2::saveState(File *f) {
+  assert(shared->State.bitPosition == 0);
+  f->blockWrite(reinterpret_cast<uint8_t *>(&hashTable[0]), hashTable.size() * sizeof(Bucket16));
+}
+
+void ContextMap2::loadState(File *f) {
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&hashTable[0]), hashTable.size() * sizeof(Bucket16));
 }
 
 void ContextMap2::print() {
   uint64_t used = 0;
   uint64_t empty = 0;
-  for (int i = 0; i < hashTable.size(); i++)
+  for (uint64_t i = 0; i < hashTable.size(); i++)
   {
     auto bucket = &hashTable[i];
     bucket->stat(used, empty);
   }
   printf("ContextMap2 used: %" PRIu64 " empty: %" PRIu64, used, empty);
-}
\ No newline at end of file
+}
+
+template void ContextMap2::update<SIMDType::SIMD_NONE>();
+template void ContextMap2::update<SIMDType::SIMD_SSE2>();
+template void ContextMap2::update<SIMDType::SIMD_SSSE3>();
+template void ContextMap2::update<SIMDType::SIMD_AVX2>();
+template void ContextMap2::update<SIMDType::SIMD_NEON>();
+template void ContextMap2::mix<SIMDType::SIMD_NONE>(Mixer &m);
+template void ContextMap2::mix<SIMDType::SIMD_SSE2>(Mixer &m);
+template void ContextMap2::mix<SIMDType::SIMD_SSSE3>(Mixer &m);
+template void ContextMap2::mix<SIMDType::SIMD_AVX2>(Mixer &m);
+template void ContextMap2::mix<SIMDType::SIMD_NEON>(Mixer &m);
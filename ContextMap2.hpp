@@ -27,12 +27,23 @@ mapped to predictions.
 #include "RunMap1.hpp"
 #include "StateTable.hpp"
 #include "Stretch.hpp"
+#include "file/File.hpp"
+
+#ifndef CM_PREFETCH_DISTANCE
+#define CM_PREFETCH_DISTANCE 2
+#endif
 
 class ContextMap2 {
 public:
     static constexpr int MIXERINPUTS = 3;
     static constexpr uint32_t C = 8;
 
+    /**
+     * While the slot0 of a context is probed at a byte boundary, the buckets of the pending bit history updates
+     * (see updatePendingContexts()) of the context this many positions later are prefetched (0: no look-ahead).
+     */
+    static constexpr uint32_t PREFETCH_DISTANCE = CM_PREFETCH_DISTANCE;
+
 private:
 
   static constexpr uint8_t FLAG_DEFERRED_UPDATE = 1;
@@ -40,20 +51,39 @@ private:
   struct ContextInfo {
     HashElementForContextMap* slot0; /**< pointer to current byte history in slot0 */
     HashElementForContextMap* slot012; /**< pointer to current bit history states in current slot (either slot0 or slot1 or slot2) */
-    uint32_t tableIndex; /**< @ref C whole byte context hashes */
+    uint64_t tableIndex; /**< @ref C whole byte context hashes */
     uint16_t tableChecksum; /**< @ref C whole byte context checksums */
     uint8_t flags;
     HashElementForContextMap bitStateTmp;
   };
 
     const Shared * const shared;
-    Array<Bucket16> hashTable; /**< bit and byte histories (statistics) */
+    Array<Bucket16, 64, LargePageAllocation> hashTable; /**< bit and byte histories (statistics), a bucket per cache line */
     ContextInfo contextInfoList[C]{};
-    const uint32_t mask;
-    const int hashBits;
+    bool contextsSet = false; /**< set() was called for the contexts of the current byte, their slot0 is not yet probed */
+    const uint64_t mask;
+    const int hashBits; /**< log2 of the number of buckets, up to MAX_MEM_BITS: the bucket indices have 64 bits */
 
+    /**
+     * Finds (or creates) the element for @ref checksum in the bucket at @ref index, with the search of instruction set @ref simd
+     */
+    template<SIMDType simd>
+    HashElementForContextMap* findElement(uint64_t index, uint16_t checksum);
     void updatePendingContextsInSlot(HashElementForContextMap* const p, uint32_t c);
-    void updatePendingContexts(uint32_t ctx, uint16_t checksum, uint32_t c);
+    template<SIMDType simd>
+    void updatePendingContexts(uint64_t ctx, uint16_t checksum, uint32_t c);
+    void prefetchPendingContexts(uint64_t ctx, const HashElementForContextMap* slot0);
+    template<SIMDType simd>
+    void probeContexts();
+    template<SIMDType simd>
+    void updateContext(ContextInfo* contextInfo, uint8_t y, uint8_t bpos, uint8_t c1, uint8_t c0);
+    void mixContext(Mixer &m, ContextInfo* contextInfo, uint8_t bpos, uint8_t c0);
+
+    /**
+     * Mixes all contexts at once with instruction set @ref simd (AVX2 or SSE2), giving the same inputs as mixContext()
+     */
+    template<SIMDType simd>
+    void mixContextsSimd(Mixer &m, uint8_t bpos, uint8_t c0);
     size_t getStateByteLocation(const uint32_t bpos, const uint32_t c0);
 
 public:
@@ -71,13 +101,46 @@ public:
 
     /**
      * Set next whole byte context to @ref ctx.
+     * The bucket is only prefetched: all contexts are probed together by the next mix(), so that their cache misses overlap.
      * @param ctx
      */
     void set(int index, const uint64_t ctx);
+
+    /**
+     * Set next whole byte context by its bucket index and checksum, as given by getTableIndex() and getTableChecksum()
+     */
+    void set(int index, uint64_t tableIndex, uint16_t tableChecksum);
+
+    [[nodiscard]] auto getTableIndex(const uint64_t ctx) const -> uint64_t { return finalize64Wide(ctx, hashBits); }
+    [[nodiscard]] auto getTableChecksum(const uint64_t ctx) const -> uint16_t { return checksum16(ctx, hashBits); }
+
+    /**
+     * Prefetches the buckets of slot0, slot1 and slot2 of a context at @ref tableIndex when the next byte @ref c is known (compression)
+     */
+    void prefetch(uint64_t tableIndex, uint8_t c);
+
+    /**
+     * Updates the bit histories of all contexts with the last bit (and their byte histories at a byte boundary),
+     * and at bits 2 and 5 finds the slots of the next bits; mix() then mixes the contexts for the next bit.
+     */
+    template<SIMDType simd>
     void update();
+
+    /**
+     * Adds the inputs of the contexts to @ref m. The SIMD versions (selected by @ref simd) give the same inputs
+     * as the scalar one, which is the reference.
+     */
+    template<SIMDType simd>
     void mix(Mixer &m);
     void print();
 
+    /**
+     * Writes/reads the hash table for a model snapshot.
+     * Must be called at a byte boundary: the per-context state is rebuilt by set() for the next byte.
+     */
+    void saveState(File *f);
+    void loadState(File *f);
+
     RunMap1 runMap1;
     StateMap1 stateMap1;
 };
@@ -3,17 +3,23 @@
 
 /**
  * This class provides a static (common) 1024-element lookup table for integer division
- * Initialization will run multiple times, but the table is created only once
+ * The table is created only once (thread-safe: predictors in worker threads share it)
  * @todo Split into declaration and definition
  */
 class DivisionTable {
+private:
+    struct Table {
+      int dt[1024]; // i -> 16K/(i+i+3)
+      Table() {
+        for( int i = 0; i < 1024; ++i ) {
+          dt[i] = 16384 / (i + i + 3);
+        }
+      }
+    };
 public:
     static auto getDT() -> int * {
-      static int dt[1024]; // i -> 16K/(i+i+3)
-      for( int i = 0; i < 1024; ++i ) {
-        dt[i] = 16384 / (i + i + 3);
-      }
-      return dt;
+      static Table table;
+      return table.dt;
     }
 };
 
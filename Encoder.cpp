@@ -1,32 +1,39 @@
 #include "Encoder.hpp"
 #include <math.h>
 
-Encoder::Encoder(Shared* const sh, Mode m, File *f) : shared(sh), ari(f), mode(m), archive(f), alt(nullptr), predictorMain(sh) {
+template<SIMDType simd>
+Encoder<simd>::Encoder(Shared* const sh, Mode m, File *f) : shared(sh), ari(f), mode(m), archive(f), alt(nullptr), predictorMain(sh) {
+  shared->speculativePrefetch = mode == DECOMPRESS;
   if( mode == DECOMPRESS ) {
-    uint64_t start = size();
-    archive->setEnd();
-    uint64_t end = size();
-    setStatusRange(0.0, static_cast<float>(end));
-    archive->setpos(start);
-    ari.prefetch();
+    ari.prefetch(); // the archive may be a stream: the caller sets the status range when the archive size is known
   }
 }
 
-auto Encoder::getMode() const -> Mode {
+template<SIMDType simd>
+auto Encoder<simd>::getMode() const -> Mode {
   return mode; 
 }
 
-auto Encoder::size() const -> uint64_t {
-  return archive->curPos(); 
+template<SIMDType simd>
+auto Encoder<simd>::size() const -> uint64_t {
+  return archive->curPos() + ari.out.pending();
 }
 
-void Encoder::flush() {
+template<SIMDType simd>
+void Encoder<simd>::flush() {
   ari.flush();
 }
 
-void Encoder::setFile(File *f) { alt = f; }
+template<SIMDType simd>
+void Encoder<simd>::flushBuffer() {
+  ari.out.flush();
+}
+
+template<SIMDType simd>
+void Encoder<simd>::setFile(File *f) { alt = f; }
 
-void Encoder::compressByte(Predictor *predictor, uint8_t c) {
+template<SIMDType simd>
+void Encoder<simd>::compressByte(Predictor<simd> *predictor, uint8_t c) {
     for( int i = 7; i >= 0; --i ) {
       uint32_t p = predictor->p();
       int y = (c >> i) & 1;
@@ -37,7 +44,22 @@ void Encoder::compressByte(Predictor *predictor, uint8_t c) {
     assert(shared->State.c1 == c);
 }
 
-uint8_t Encoder::decompressByte(Predictor *predictor) {
+template<SIMDType simd>
+void Encoder<simd>::compressBytes(Predictor<simd> *predictor, const uint8_t *data, uint64_t n) {
+  assert(mode == COMPRESS);
+  while( n > 0 ) {
+    const uint32_t k = static_cast<uint32_t>(std::min<uint64_t>(n, NormalModel::LOOKAHEAD_SIZE));
+    predictor->normalModel.lookahead(data, k);
+    for( uint32_t i = 0; i < k; i++ ) {
+      compressByte(predictor, data[i]);
+    }
+    data += k;
+    n -= k;
+  }
+}
+
+template<SIMDType simd>
+uint8_t Encoder<simd>::decompressByte(Predictor<simd> *predictor) {
   for( int i = 0; i < 8; ++i ) {
     int p = predictor->p();
     int y = ari.decodeBit(p);
@@ -46,23 +68,58 @@ uint8_t Encoder::decompressByte(Predictor *predictor) {
   return shared->State.c1;
 }
 
-void Encoder::updateModels(Predictor* predictor, uint32_t p, int y) {
+template<SIMDType simd>
+void Encoder<simd>::updateModels(Predictor<simd>* predictor, uint32_t p, int y) {
   bool isMissed = ((p >> (16 - 1)) != y);
   shared->update(y, isMissed);
   predictor->Update();
 }
 
-void Encoder::setStatusRange(float perc1, float perc2) {
+template<SIMDType simd>
+void Encoder<simd>::saveState(File *f) {
+  assert(mode == COMPRESS && shared->State.bitPosition == 0);
+  flushBuffer();
+  f->put64(archive->curPos());
+  f->put64(ari.x1);
+  f->put64(ari.x2);
+  shared->saveState(f);
+  predictorMain.saveState(f);
+}
+
+template<SIMDType simd>
+void Encoder<simd>::loadState(File *f) {
+  assert(mode == DECOMPRESS);
+  const uint64_t archivePos = f->get64();
+  ari.x1 = static_cast<uint32_t>(f->get64());
+  ari.x2 = static_cast<uint32_t>(f->get64());
+  shared->loadState(f);
+  predictorMain.loadState(f);
+  // the decoder's x holds the 4 archive bytes following those written by the encoder so far
+  archive->setpos(archivePos);
+  ari.in.reset();
+  ari.prefetch();
+}
+
+template<SIMDType simd>
+void Encoder<simd>::setStatusRange(float perc1, float perc2) {
   p1 = perc1;
   p2 = perc2;
 }
 
-void Encoder::printStatus(uint64_t n, uint64_t size) const {
+template<SIMDType simd>
+void Encoder<simd>::printStatus(uint64_t n, uint64_t size) const {
   fprintf(stderr, "%6.2f%%\b\b\b\b\b\b\b", (p1 + (p2 - p1) * n / (size + 1)) * 100);
   fflush(stderr);
 }
 
-void Encoder::printStatus() const {
+template<SIMDType simd>
+void Encoder<simd>::printStatus() const {
   fprintf(stderr, "%6.2f%%\b\b\b\b\b\b\b", float(size()) / (p2 + 1) * 100);
   fflush(stderr);
 }
+
+template class Encoder<SIMDType::SIMD_NONE>;
+template class Encoder<SIMDType::SIMD_SSE2>;
+template class Encoder<SIMDType::SIMD_SSSE3>;
+template class Encoder<SIMDType::SIMD_AVX2>;
+template class Encoder<SIMDType::SIMD_NEON>;
@@ -12,7 +12,9 @@ typedef enum {
 /**
  * An Encoder does arithmetic encoding.
  * If shared->level is 0, then data is stored without arithmetic coding.
+ * It is compiled for each instruction set (@ref simd) with its Predictor, so that the coding loop of a byte inlines the models.
  */
+template<SIMDType simd>
 class Encoder {
 private:
     ArithmeticEncoder ari;
@@ -22,18 +24,18 @@ private:
     float p1 {}, p2 {}; /**< percentages for progress indicator: 0.0 .. 1.0 */
     Shared * const shared;
 
-    void updateModels(Predictor* predictor, uint32_t p, int y);
+    void updateModels(Predictor<simd>* predictor, uint32_t p, int y);
 
 public:
 
-    Predictor predictorMain;
+    Predictor<simd> predictorMain;
     //Predictor predictor;
 
     /**
      * Encoder(COMPRESS, f) creates encoder for compression to archive @ref f, which
      * must be open past any header for writing in binary mode.
      * Encoder(DECOMPRESS, f) creates encoder for decompression from archive @ref f,
-     * which must be open past any header for reading in binary mode.
+     * which must be open past any header for reading in binary mode. It is read sequentially.
      * @param m the mode to operate in
      * @param f the file to read from or write to
      */
@@ -41,7 +43,7 @@ public:
     [[nodiscard]] auto getMode() const -> Mode;
 
     /**
-     * Returns current length of archive
+     * Returns current length of archive, including the output of the arithmetic coder that is still buffered
      * @return length of archive so far
      */
     [[nodiscard]] auto size() const -> uint64_t;
@@ -52,6 +54,12 @@ public:
      */
     void flush();
 
+    /**
+     * Writes the buffered output of the arithmetic coder to the archive in COMPRESS mode.
+     * flush() does it as well: call it only when the archive is needed before that.
+     */
+    void flushBuffer();
+
     /**
      * Sets alternate source to @ref f for decompressByte() in COMPRESS mode (for testing transforms).
      * @param f
@@ -62,13 +70,35 @@ public:
      * compressByte(c) in COMPRESS mode compresses one byte.
      * @param c the byte to be compressed
      */
-    void compressByte(Predictor *predictor, uint8_t c);
+    void compressByte(Predictor<simd> *predictor, uint8_t c);
+
+    /**
+     * compressBytes(data, n) in COMPRESS mode compresses @ref n bytes.
+     * The same as calling compressByte() for each, but the model contexts are computed ahead (see NormalModel::lookahead()).
+     * @param data the bytes to be compressed
+     * @param n number of bytes
+     */
+    void compressBytes(Predictor<simd> *predictor, const uint8_t *data, uint64_t n);
 
     /**
      * decompressByte() in DECOMPRESS mode decompresses and returns one byte.
      * @return the decompressed byte
      */
-    uint8_t decompressByte(Predictor *predictor);
+    uint8_t decompressByte(Predictor<simd> *predictor);
+
+    /**
+     * Writes a snapshot of the complete coder and model state to @ref f.
+     * Must be called at a byte boundary in COMPRESS mode.
+     * @param f the file to write the snapshot to
+     */
+    void saveState(File *f);
+
+    /**
+     * Restores the state saved by saveState() in DECOMPRESS mode and positions the archive,
+     * so that decoding continues from the byte where the snapshot was taken.
+     * @param f the file to read the snapshot from
+     */
+    void loadState(File *f);
 
     void setStatusRange(float perc1, float perc2);
     void printStatus(uint64_t n, uint64_t size) const;
@@ -0,0 +1,105 @@
+#ifndef PAQ8PX_FINALMIXER_HPP
+#define PAQ8PX_FINALMIXER_HPP
+
+#include "Mixer.hpp"
+#include "Squash.hpp"
+
+/**
+ * The final layer of a 2-layer mixer network: combines the outputs of the @ref N context sets of the first layer
+ * with a single weight row.
+ * It gives the same predictions as a SIMDMixer(sh, N, 1, 1) of any instruction set, without padding the inputs
+ * to the SIMD width: with a constant @ref N the loops are unrolled.
+ * @tparam N number of inputs
+ */
+template<uint32_t N>
+class FinalMixer {
+private:
+    const Shared * const shared;
+    short tx[N] {}; /**< inputs from add() */
+    short wx[N] {}; /**< weights */
+    uint32_t nx {}; /**< number of inputs in tx, 0 to N */
+    int scaleFactor {}; /**< scale factor for dot product */
+    int rate = Mixer::MAX_LEARNING_RATE; /**< learning rate */
+    int pr = 2048; /**< last result (scaled 12 bits) */
+
+public:
+    explicit FinalMixer(const Shared* const sh) : shared(sh) {}
+
+    void setScaleFactor(const int sf) {
+      scaleFactor = sf;
+    }
+
+    /**
+     * Input x (call @ref N times before p())
+     */
+    void add(const int x) {
+      assert(nx < N);
+      assert(x == short(x));
+      tx[nx++] = static_cast<short>(x);
+    }
+
+    /**
+     * @return the prediction that the next bit is 1 (scaled 12 bits)
+     */
+    auto p() -> int {
+      assert(nx == N && scaleFactor > 0);
+      // the products are summed in pairs and scaled, like the SIMD dot products (see dotProductSimdNone())
+      int dp = 0;
+      for( uint32_t i = 0; i < N; i += 2 ) {
+        const int product1 = i + 1 < N ? tx[i + 1] * wx[i + 1] : 0;
+        dp += (tx[i] * wx[i] + product1) >> 8;
+      }
+      dp = (dp * scaleFactor) >> 16;
+      return pr = squash(dp);
+    }
+
+    /**
+     * Trains the weights with the last bit (see trainSimdNone())
+     */
+    void update() {
+      INJECT_SHARED_y
+      const int err = (y << 12) - pr;
+      if( rate > Mixer::MIN_LEARNING_RATE_S1 ) {
+        rate--;
+      }
+      const int e = (err * rate) >> 16;
+      for( uint32_t i = 0; i < N; i++ ) {
+        int wt = wx[i] + ((((tx[i] * e * 2) >> 16) + 1) >> 1);
+        if( wt < -32768 ) {
+          wt = -32768;
+        } else if( wt > 32767 ) {
+          wt = 32767;
+        }
+        wx[i] = static_cast<short>(wt);
+      }
+      nx = 0;
+    }
+
+    /**
+     * Writes/reads the weights, the learning rate and the last result for a model snapshot.
+     * The weights are padded with zeros to @ref paddedInputs, the layout of the weights of a SIMDMixer(sh, N, 1, 1).
+     */
+    void saveState(File *f, const uint32_t paddedInputs) {
+      assert(paddedInputs >= N);
+      short padded[N] {};
+      f->blockWrite(reinterpret_cast<uint8_t *>(&wx[0]), N * sizeof(short));
+      for( uint32_t i = N; i < paddedInputs; i += N ) {
+        f->blockWrite(reinterpret_cast<uint8_t *>(&padded[0]), std::min<uint32_t>(N, paddedInputs - i) * sizeof(short));
+      }
+      f->blockWrite(reinterpret_cast<uint8_t *>(&rate), sizeof(int));
+      f->blockWrite(reinterpret_cast<uint8_t *>(&pr), sizeof(int));
+    }
+
+    void loadState(File *f, const uint32_t paddedInputs) {
+      assert(paddedInputs >= N);
+      short padded[N];
+      f->blockReadExact(reinterpret_cast<uint8_t *>(&wx[0]), N * sizeof(short));
+      for( uint32_t i = N; i < paddedInputs; i += N ) {
+        f->blockReadExact(reinterpret_cast<uint8_t *>(&padded[0]), std::min<uint32_t>(N, paddedInputs - i) * sizeof(short));
+      }
+      f->blockReadExact(reinterpret_cast<uint8_t *>(&rate), sizeof(int));
+      f->blockReadExact(reinterpret_cast<uint8_t *>(&pr), sizeof(int));
+    }
+};
+
+#endif //PAQ8PX_FINALMIXER_HPP
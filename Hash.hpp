@@ -62,6 +62,19 @@ auto finalize64(const uint64_t hash, const int hashBits) -> uint32_t {
   return static_cast<uint32_t>(hash >> (64 - hashBits));
 }
 
+/**
+ * Finalizer for the bucket index of a hash table with more than 2^32 buckets.
+ * At most 48 bits, so that the 16 bits of checksum16() still follow it in the hash.
+ * @param hash
+ * @param hashBits
+ * @return
+ */
+static ALWAYS_INLINE
+auto finalize64Wide(const uint64_t hash, const int hashBits) -> uint64_t {
+  assert(hashBits > 0 && hashBits <= 48);
+  return hash >> (64 - hashBits);
+}
+
 /**
  * Get the next 8 or 16 bits following "hashBits" for checksum
  * @param hash
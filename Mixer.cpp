@@ -3,7 +3,8 @@
 
 Mixer::Mixer(const Shared* const sh, const int n, const int m, const int s) : shared(sh),
   n(n), m(m), s(s), 
-  scaleFactor(0), tx(n), wx(n * m), cxt(s), rates(s), pr(s) {
+  scaleFactor(0), tx(n, MemoryComponent::Mixer), wx(n * m, MemoryComponent::Mixer), cxt(s, MemoryComponent::Mixer),
+  rates(s, MemoryComponent::Mixer), pr(s, MemoryComponent::Mixer) {
   for( uint64_t i = 0; i < s; ++i ) {
     pr[i] = 2048; //initial p=0.5
     rates[i] = MAX_LEARNING_RATE;
@@ -17,6 +18,13 @@ void Mixer::add(const int x) {
   tx[nx++] = static_cast<short>(x);
 }
 
+short *Mixer::addInputs(const uint32_t count) {
+  assert(count > 0 && nx + count <= n);
+  short *const inputs = &tx[nx];
+  nx += count;
+  return inputs;
+}
+
 void Mixer::set(const uint32_t cx, const uint32_t range) {
   assert(numContexts < s);
   assert(cx < range);
@@ -25,6 +33,18 @@ void Mixer::set(const uint32_t cx, const uint32_t range) {
   base += range;
 }
 
+void Mixer::saveState(File *f) {
+  f->blockWrite(reinterpret_cast<uint8_t *>(&wx[0]), wx.size() * sizeof(short));
+  f->blockWrite(reinterpret_cast<uint8_t *>(&rates[0]), rates.size() * sizeof(int));
+  f->blockWrite(reinterpret_cast<uint8_t *>(&pr[0]), pr.size() * sizeof(int));
+}
+
+void Mixer::loadState(File *f) {
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&wx[0]), wx.size() * sizeof(short));
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&rates[0]), rates.size() * sizeof(int));
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&pr[0]), pr.size() * sizeof(int));
+}
+
 void Mixer::reset() {
   nx = 0;
   base = 0;
@@ -3,6 +3,7 @@
 
 #include "Shared.hpp"
 #include "Utils.hpp"
+#include "file/File.hpp"
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_X64)
 #include <immintrin.h>
@@ -173,12 +174,12 @@ static void trainSimdNone(const short *const t, short *const w, int n, const int
 
 
 class Mixer {
-protected:
+public:
     static constexpr int MAX_LEARNING_RATE = int(8 * 65536 - 1);
     static constexpr int MIN_LEARNING_RATE_S1 = int(3 * 65536 - 1);
     static constexpr int MIN_LEARNING_RATE_SN = int(4.5 * 65536 - 1);
-    
 
+protected:
     const Shared * const shared;
     const uint32_t n; /**< max inputs */
     const uint32_t m; /**< max contexts */
@@ -197,7 +198,7 @@ public:
      * Mixer m(n, m, s) combines models using @ref m neural networks with
      * @ref n inputs each, of which up to @ref s may be selected.  If s > 1 then
      * the outputs of these neural networks are combined using another
-     * neural network (with arguments s, 1, 1). If s = 1 then the
+     * neural network (a FinalMixer with s inputs). If s = 1 then the
      * output is direct.
      * @param n
      * @param m
@@ -224,6 +225,13 @@ public:
      */
     void add(int x);
 
+    /**
+     * Reserves the next @ref count inputs for the caller to write them directly (instead of calling add() @ref count times).
+     * @param count
+     * @return the address of the first reserved input
+     */
+    short *addInputs(uint32_t count);
+
     /**
      *  Selects @ref cx as one of @ref range neural networks to
      *  use. 0 <= cx < range. Should be called up to @ref s times such
@@ -234,6 +242,13 @@ public:
      */
     void set(uint32_t cx, uint32_t range);
     void reset();
+
+    /**
+     * Writes/reads the weights and learning rates (including those of the final mixer) for a model snapshot.
+     * Must be called after update(): the inputs and the selected contexts are not saved.
+     */
+    virtual void saveState(File *f);
+    virtual void loadState(File *f);
 };
 
 #endif //PAQ8PX_MIXER_HPP
@@ -1,39 +1,64 @@
 #include "Predictor.hpp"
 
-Predictor::Predictor(Shared* const sh) : 
+template<SIMDType simd>
+Predictor<simd>::Predictor(Shared* const sh) :
   shared(sh),
-  mixerFactory(sh),
   normalModel(sh, sh->mem),
-  m(mixerFactory.createMixer(
+  m(sh,
     1 +  //bias
     NormalModel::MIXERINPUTS
     ,
     NormalModel::MIXERCONTEXTS
-    ,
-    NormalModel::MIXERCONTEXTSETS
-  ))
+  )
 {
   shared->reset();
-  m->setScaleFactor(1150, 240);
+  m.setScaleFactor(1150, 240);
+}
+
+template<SIMDType simd>
+auto Predictor<simd>::planMemory(const uint64_t mem) -> MemoryPlan {
+  MemoryPlan plan;
+  plan.mem = mem;
+  NormalModel::planMemory(mem, plan);
+  SIMDMixer<simd, NormalModel::MIXERCONTEXTSETS>::planMemory(1 + NormalModel::MIXERINPUTS, NormalModel::MIXERCONTEXTS, plan);
+  return plan;
 }
 
-void Predictor::Update() {
-  normalModel.cm.update();
+template<SIMDType simd>
+void Predictor<simd>::Update() {
+  normalModel.cm.template update<simd>();
   normalModel.smOrder0.update();
   normalModel.smOrder1.update();
   normalModel.smOrder2.update();
-  m->update();
+  m.update();
 }
 
-uint32_t Predictor::p() {
+template<SIMDType simd>
+uint32_t Predictor<simd>::p() {
 
-  m->add(256); //network bias
+  m.add(256); //network bias
 
-  normalModel.mix(*m);
-  uint32_t pr=m->p();
+  normalModel.template mix<simd>(m);
+  uint32_t pr=m.p();
 
   pr=pr<<4;
   return pr;
 }
 
+template<SIMDType simd>
+void Predictor<simd>::saveState(File *f) {
+  normalModel.saveState(f);
+  m.saveState(f);
+}
+
+template<SIMDType simd>
+void Predictor<simd>::loadState(File *f) {
+  normalModel.loadState(f);
+  m.loadState(f);
+}
 
+template class Predictor<SIMDType::SIMD_NONE>;
+template class Predictor<SIMDType::SIMD_SSE2>;
+template class Predictor<SIMDType::SIMD_SSSE3>;
+template class Predictor<SIMDType::SIMD_AVX2>;
+template class Predictor<SIMDType::SIMD_NEON>;
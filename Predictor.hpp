@@ -2,26 +2,41 @@
 #define PAQ8PX_PREDICTOR_HPP
 
 #include "Shared.hpp"
-#include "Mixer.hpp"
-#include "MixerFactory.hpp"
+#include "SimdMixer.hpp"
 #include "model/NormalModel.hpp"
 
 
 /**
  * A Predictor estimates the probability that the next bit of uncompressed data is 1.
+ * It is compiled for each instruction set (@ref simd), so that the per bit calls of the models and the mixer are direct.
  */
+template<SIMDType simd>
 class Predictor {
 private:
     Shared *shared;
-    MixerFactory mixerFactory;
-    Mixer* m;
 
 public:
   NormalModel normalModel;
+
+private:
+  SIMDMixer<simd, NormalModel::MIXERCONTEXTSETS> m;
+
+public:
   Predictor(Shared* const sh);
+
+  /**
+   * @return the bytes a Predictor allocates with a ContextMap2 of @ref mem buckets (Shared::mem)
+   */
+  static auto planMemory(uint64_t mem) -> MemoryPlan;
   void Update();
   uint32_t p();
 
+  /**
+   * Writes/reads the state of all models and mixers for a model snapshot (at a byte boundary).
+   */
+  void saveState(File *f);
+  void loadState(File *f);
+
 };
 
 #endif //PAQ8PX_PREDICTOR_HPP
@@ -1,4 +1,11 @@
 #include "ProgramChecker.hpp"
+#include "SystemDefines.hpp"
+#include "Utils.hpp"
+#include <cstdlib>
+#ifdef __linux__
+#include <sys/mman.h> //mincore()
+#include <sys/resource.h> //getrusage()
+#endif
 
 ProgramChecker *ProgramChecker::instance = nullptr;
 
@@ -9,16 +16,79 @@ auto ProgramChecker::getInstance() -> ProgramChecker * {
   return instance;
 }
 
-void ProgramChecker::alloc(uint64_t n) {
+void ProgramChecker::alloc(const void *address, uint64_t n, MemoryComponent component, const uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
   memUsed += n;
   if( memUsed > maxMem ) {
     maxMem = memUsed;
   }
+  const int i = static_cast<int>(component);
+  componentUsed[i] += n;
+  if( componentUsed[i] > componentMax[i] ) {
+    componentMax[i] = componentUsed[i];
+  }
+  if( address == nullptr ) {
+    return;
+  }
+  if( regionCount == regionCapacity ) {
+    regionCapacity = regionCapacity * 2 + 16;
+    regions = static_cast<Region *>(realloc(regions, regionCapacity * sizeof(Region)));
+    if( regions == nullptr ) {
+      quit("Out of memory.");
+    }
+  }
+  regions[regionCount++] = {address, bytes, component};
 }
 
-void ProgramChecker::free(uint64_t n) {
+void ProgramChecker::free(const void *address, uint64_t n, MemoryComponent component) {
+  std::lock_guard<std::mutex> lock(mutex);
   assert(memUsed >= n);
   memUsed -= n;
+  const int c = static_cast<int>(component);
+  assert(componentUsed[c] >= n);
+  componentUsed[c] -= n;
+  if( address == nullptr ) {
+    return;
+  }
+  componentTouched[c] = std::max(componentTouched[c], touchedBytes(component)); // the allocation is still included
+  for( uint32_t i = 0; i < regionCount; i++ ) {
+    if( regions[i].address == address ) {
+      regions[i] = regions[--regionCount];
+      break;
+    }
+  }
+}
+
+auto ProgramChecker::touchedBytes(const MemoryComponent component) const -> uint64_t {
+  uint64_t touched = 0;
+#ifdef __linux__
+  const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  unsigned char residency[4096];
+  for( uint32_t i = 0; i < regionCount; i++ ) {
+    if( regions[i].component != component ) {
+      continue;
+    }
+    // the pages of the allocation: small heap allocations share their pages with others
+    const uintptr_t start = reinterpret_cast<uintptr_t>(regions[i].address) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(regions[i].address) + regions[i].bytes;
+    for( uintptr_t p = start; p < end; p += sizeof(residency) * pageSize ) {
+      const uint64_t pages = std::min<uint64_t>(sizeof(residency), (end - p + pageSize - 1) / pageSize);
+      if( mincore(reinterpret_cast<void *>(p), pages * pageSize, residency) == 0 ) {
+        for( uint64_t j = 0; j < pages; j++ ) {
+          touched += (residency[j] & 1) * pageSize;
+        }
+        continue;
+      }
+      // some of the pages are not mapped: count the others one by one
+      for( uint64_t j = 0; j < pages; j++ ) {
+        if( mincore(reinterpret_cast<void *>(p + j * pageSize), pageSize, residency) == 0 ) {
+          touched += (residency[0] & 1) * pageSize;
+        }
+      }
+    }
+  }
+#endif
+  return touched;
 }
 
 auto ProgramChecker::getRuntime() const -> double {
@@ -26,9 +96,62 @@ auto ProgramChecker::getRuntime() const -> double {
   return std::chrono::duration<double>(finishTime - startTime).count();
 }
 
+void ProgramChecker::addBacking(MemoryBacking backing, uint64_t n) {
+  std::lock_guard<std::mutex> lock(mutex);
+  backingBytes[static_cast<int>(backing)] += n;
+}
+
+void ProgramChecker::addIoWaitTime(double seconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ioWaitTime += seconds;
+}
+
+auto ProgramChecker::getIoWaitTime() const -> double { return ioWaitTime; }
+
+auto ProgramChecker::getPageFaults() -> uint64_t {
+#ifdef __linux__
+  struct rusage usage {};
+  if( getrusage(RUSAGE_SELF, &usage) == 0 ) {
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+  }
+#endif
+  return 0;
+}
+
 void ProgramChecker::print() const {
   const double runtime = getRuntime();
   printf("Time %1.2f sec, used %" PRIu64 " MB (%" PRIu64 " bytes) of memory\n", runtime, maxMem >> 20U, maxMem);
+  static const char *backingNames[static_cast<int>(MemoryBacking::Count)] = {"heap", "4 KB pages (no huge pages available)",
+                                                                             "transparent huge pages", "2 MB huge pages", "1 GB huge pages"};
+  bool printed = false;
+  for( int i = static_cast<int>(MemoryBacking::Pages); i < static_cast<int>(MemoryBacking::Count); i++ ) {
+    if( backingBytes[i] != 0 ) {
+      printf("%s %" PRIu64 " MB %s", printed ? "," : "Large tables on:", backingBytes[i] >> 20U, backingNames[i]);
+      printed = true;
+    }
+  }
+  if( printed ) {
+    printf("\n");
+  }
+}
+
+void ProgramChecker::printMemory(const MemoryPlan &plan, const uint32_t models) {
+  std::lock_guard<std::mutex> lock(mutex);
+  static const char *componentNames[static_cast<int>(MemoryComponent::Count)] = {"Hash table", "Order 2 map", "Other state maps",
+                                                                                 "Mixers", "Input buffers", "Other"};
+  printf(" %-16s %9s %10s %10s\n", "Memory (KB)", "planned", "reserved", "touched");
+  for( int i = 0; i < static_cast<int>(MemoryComponent::Count); i++ ) {
+    componentTouched[i] = std::max(componentTouched[i], touchedBytes(static_cast<MemoryComponent>(i)));
+    printf(" %-16s %9" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", componentNames[i], (plan.bytes[i] * models) >> 10U, componentMax[i] >> 10U,
+           componentTouched[i] >> 10U);
+  }
+  printf(" %-16s %9" PRIu64 " %10" PRIu64 "\n", "Total", (plan.total() * models) >> 10U, maxMem >> 10U);
+#ifdef __linux__
+  struct rusage usage {};
+  if( getrusage(RUSAGE_SELF, &usage) == 0 ) {
+    printf(" Peak resident memory of the process: %ld KB\n", usage.ru_maxrss);
+  }
+#endif
 }
 
 ProgramChecker::~ProgramChecker() {
@@ -1,20 +1,44 @@
 #ifndef PAQ8PX_PROGRAMCHECKER_HPP
 #define PAQ8PX_PROGRAMCHECKER_HPP
 
+#include "Allocation.hpp"
 #include <cassert>
 #include <chrono>
 #include <cinttypes>
 #include <cstdint>
 #include <cstdio>
+#include <mutex>
 
 /**
  * Track time and memory used.
  * @remark: only @ref Array<T> reports its memory usage, we don't know about other types
+ * @remark: alloc() and free() may be called concurrently from worker threads
+ * The memory is itemized by component (see @ref MemoryComponent): the bytes reserved (allocated) and the bytes
+ * touched (resident in physical memory, as reported by mincore() on Linux). The touched bytes of a component are
+ * sampled when one of its allocations is freed and by printMemory(): the highest sample is reported.
  */
 class ProgramChecker {
 private:
     uint64_t memUsed {};  /**< Bytes currently in use (all allocated minus all freed) */
     uint64_t maxMem {};   /**< Most bytes allocated ever */
+    double ioWaitTime {}; /**< Seconds the coding thread spent waiting for the reader/writer threads */
+    uint64_t backingBytes[static_cast<int>(MemoryBacking::Count)] {}; /**< Bytes allocated ever on each kind of memory */
+    uint64_t componentUsed[static_cast<int>(MemoryComponent::Count)] {}; /**< Bytes currently in use by each component */
+    uint64_t componentMax[static_cast<int>(MemoryComponent::Count)] {}; /**< Most bytes allocated ever by each component */
+    uint64_t componentTouched[static_cast<int>(MemoryComponent::Count)] {}; /**< Most bytes touched by each component */
+
+    /**
+     * An allocation in use (for sampling the touched bytes)
+     */
+    struct Region {
+      const void *address;
+      uint64_t bytes;
+      MemoryComponent component;
+    };
+    Region *regions {};   /**< The allocations in use (malloc'ed: Array can't be used here) */
+    uint32_t regionCount {};
+    uint32_t regionCapacity {};
+    std::mutex mutex;     /**< Guards all of the above and ioWaitTime */
     std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
 
     /**
@@ -37,14 +61,42 @@ private:
     static ProgramChecker *instance;
 public:
     static auto getInstance() -> ProgramChecker *;
-    void alloc(uint64_t n);
-    void free(uint64_t n);
+
+    /**
+     * @return the bytes of the allocations of @ref component that are resident in physical memory (0 if unknown)
+     */
+    auto touchedBytes(MemoryComponent component) const -> uint64_t;
+
+    /**
+     * Records an allocation of @ref n bytes by @ref component, whose elements span @ref bytes at @ref address
+     * (without the alignment padding, which may run past the end of a page aligned mapping)
+     */
+    void alloc(const void *address, uint64_t n, MemoryComponent component, uint64_t bytes);
+    void free(const void *address, uint64_t n, MemoryComponent component);
+
+    /**
+     * Records the kind of memory an allocation of @ref n bytes is backed by
+     */
+    void addBacking(MemoryBacking backing, uint64_t n);
     [[nodiscard]] auto getRuntime() const -> double;
+    void addIoWaitTime(double seconds);
 
     /**
-     * Print elapsed time and used memory
+     * @return the number of page faults of the process so far (0 when unknown)
+     */
+    static auto getPageFaults() -> uint64_t;
+    [[nodiscard]] auto getIoWaitTime() const -> double;
+
+    /**
+     * Print elapsed time and used memory (and the memory allocated on pages other than the heap)
      */
     void print() const;
+
+    /**
+     * Prints the memory of each component: planned (by @ref plan for @ref models models), reserved, touched,
+     * and the peak resident memory of the process
+     */
+    void printMemory(const MemoryPlan &plan, uint32_t models);
     ~ProgramChecker();
 };
 
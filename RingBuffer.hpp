@@ -18,7 +18,7 @@ public:
      * Creates an array of @ref size bytes (must be a power of 2).
      * @param size number of bytes in array
      */
-    explicit RingBuffer(const uint32_t size = 0) : b(size), mask(size - 1) {
+    explicit RingBuffer(const uint32_t size = 0) : b(size, MemoryComponent::InputBuffer), mask(size - 1) {
       assert(isPowerOf2(size));
     }
 
@@ -33,6 +33,14 @@ public:
       return offset;
     }
 
+    /**
+     * Sets the number of input bytes (when the content is restored from a model snapshot).
+     * @param newPos
+     */
+    void setpos(const uint32_t newPos) {
+      offset = newPos;
+    }
+
     void fill(const T B) {
       const auto n = (uint32_t) b.size();
       for( uint32_t i = 0; i < n; i++ ) {
@@ -14,6 +14,48 @@ void Shared::init(uint8_t level, uint32_t bufMem) {
   toScreen = !isOutputRedirected();
 }
 
+void Shared::setMem(const uint64_t mem) {
+  assert(isPowerOf2(mem));
+  this->mem = mem;
+}
+
+auto Shared::memBits() const -> uint8_t {
+  uint8_t bits = 0;
+  while( (UINT64_C(1) << bits) < mem ) {
+    bits++;
+  }
+  return bits;
+}
+
+auto Shared::levelByte() const -> uint8_t {
+  return level | (mem != UINT64_C(65536) << level ? OPTION_MEMORY : 0);
+}
+
+void Shared::writeLevel(File *f, const uint8_t options) const {
+  f->putChar(levelByte() | options);
+  if( (levelByte() & OPTION_MEMORY) != 0 ) {
+    f->putChar(memBits());
+  }
+}
+
+auto Shared::readLevel(File *f, uint8_t &options) -> bool {
+  const int c = f->getchar();
+  const uint8_t level = static_cast<uint8_t>(c) & LEVEL_MASK;
+  if( c == EOF || level < 1 || level > MAX_LEVEL ) {
+    return false;
+  }
+  init(level);
+  options = static_cast<uint8_t>(c) & ~LEVEL_MASK & ~OPTION_MEMORY;
+  if( (c & OPTION_MEMORY) != 0 ) {
+    const int bits = f->getchar();
+    if( bits < MIN_MEM_BITS || bits > MAX_MEM_BITS ) {
+      return false;
+    }
+    setMem(UINT64_C(1) << bits);
+  }
+  return true;
+}
+
 void Shared::update(int y, bool isMissed) {
   State.y = y;
   State.c0 += State.c0 + y;
@@ -34,6 +76,22 @@ void Shared::reset() {
   State.c0 = 1;
 }
 
+void Shared::saveState(File *f) {
+  f->blockWrite(reinterpret_cast<uint8_t *>(&State), sizeof(State));
+  f->put64(buf.getpos());
+  for( uint32_t i = 0; i < buf.size(); i++ ) {
+    f->putChar(buf[i]);
+  }
+}
+
+void Shared::loadState(File *f) {
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&State), sizeof(State));
+  buf.setpos(static_cast<uint32_t>(f->get64()));
+  for( uint32_t i = 0; i < buf.size(); i++ ) {
+    buf.set(i, static_cast<uint8_t>(f->getchar()));
+  }
+}
+
 auto Shared::isOutputRedirected() -> bool {
 #ifdef WINDOWS
   DWORD FileType = GetFileType(GetStdHandle(STD_OUTPUT_HANDLE));
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include "RingBuffer.hpp"
 #include "SIMDType.hpp"
+#include "file/File.hpp"
 
 // helper #defines to access shared variables
 #define INJECT_SHARED_buf   const RingBuffer<uint8_t> &buf=shared->buf;
@@ -14,6 +15,26 @@
 #define INJECT_SHARED_bpos  const uint8_t  bpos=shared->State.bitPosition;
 #define INJECT_SHARED_c4    const uint32_t c4=shared->State.c4;
 
+/**
+ * The format of the archive, written after PROGNAME: to be changed when the coded bitstream changes.
+ * Its level bits are 0, so it is never a valid level byte: the archives without it (PROGNAME directly followed by the
+ * level byte) are recognized, and the earlier versions reject the archives with it. The next values: 0x40, 0x60, ...
+ */
+static constexpr uint8_t ARCHIVE_VERSION = 0x20;
+
+// The archive header stores the level in the low bits and the format options in the high bits of the same byte
+static constexpr uint8_t LEVEL_MASK = 0x1F;
+static constexpr uint8_t OPTION_BLOCKS = 0x80; /**< content is coded as independent blocks (see compressFileBlocks()) */
+static constexpr uint8_t OPTION_STREAM = 0x40; /**< content of unknown size is coded in frames (see compressStream()) */
+static constexpr uint8_t OPTION_MEMORY = 0x20; /**< the model memory is not the one of the level: log2(Shared::mem) follows the level byte (see -auto, -mem) */
+
+static constexpr uint8_t MAX_LEVEL = 16; /**< the hash table of a level has 2^(16+level) buckets: 256 GB at level 16 */
+
+// The model memory (Shared::mem, ContextMap2 buckets) may be sized from 2^MIN_MEM_BITS to 4 times the memory of the
+// highest level (a 1 TB hash table) by -auto and -mem
+static constexpr uint8_t MIN_MEM_BITS = 12;
+static constexpr uint8_t MAX_MEM_BITS = 16 + MAX_LEVEL + 2;
+
 /**
  * Shared information by all the models and some other classes.
  */
@@ -25,9 +46,14 @@ public:
 
     RingBuffer<uint8_t> buf; /**< Rotating input queue set by Predictor */
     SIMDType chosenSimd = SIMDType::SIMD_NONE; /**< default value, will be overridden by the CPU dispatcher, and may be overridden from the command line */
-    uint8_t level = 0; /**< level=0: no compression (only transformations), level=1..12 compress using less..more RAM */
-    uint64_t mem = 0; /**< pre-calculated value of 65536 * 2^level */
+    uint8_t level = 0; /**< level=0: no compression (only transformations), level=1..MAX_LEVEL compress using less..more RAM */
+    uint64_t mem = 0; /**< pre-calculated value of 65536 * 2^level, or as sized by -auto or -mem (see setMem()) */
     bool toScreen = true;
+    bool asyncIo = false; /**< read and write files on separate threads (see AsyncReader, AsyncWriter) */
+    uint32_t prefaultThreads = 0; /**< the large tables are faulted in by this many threads before coding (see -prefault), 0: by the coder */
+    NumaPolicy numaPolicy = NumaPolicy::Default; /**< placement of the large tables on the NUMA nodes (see -numa) */
+    uint32_t numaNode = 0; /**< the node of the coder with NumaPolicy::Local */
+    bool speculativePrefetch = false; /**< the coded bytes are not known in advance (decompression): prefetch for both possible next bits */
 
     struct {
 
@@ -47,9 +73,43 @@ public:
     Shared();
 
     void init(uint8_t level, uint32_t bufMem = 0);
+
+    /**
+     * Overrides the model memory of the level: the ContextMap2 hash table will have @ref mem buckets (a power of 2)
+     */
+    void setMem(uint64_t mem);
+
+    /**
+     * @return log2(@ref mem)
+     */
+    [[nodiscard]] auto memBits() const -> uint8_t;
+
+    /**
+     * @return the level with OPTION_MEMORY when the model memory is not the one of the level: the level byte of
+     * the archive header, followed by memBits() when OPTION_MEMORY is set (see writeLevel() and readLevel())
+     */
+    [[nodiscard]] auto levelByte() const -> uint8_t;
+
+    /**
+     * Writes the level byte with the format @ref options, followed by memBits() when OPTION_MEMORY is set
+     */
+    void writeLevel(File *f, uint8_t options = 0) const;
+
+    /**
+     * Reads what writeLevel() wrote and inits the level and the model memory
+     * @param options the format options of the level byte (without OPTION_MEMORY)
+     * @return false when the level or the memory is invalid
+     */
+    auto readLevel(File *f, uint8_t &options) -> bool;
     void update(int y, bool isMissed);
     void reset();
 
+    /**
+     * Writes/reads the global state and the content of the input buffer for a model snapshot.
+     */
+    void saveState(File *f);
+    void loadState(File *f);
+
 private:
 
     /**
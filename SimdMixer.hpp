@@ -1,17 +1,21 @@
 #ifndef PAQ8PX_SIMDMIXER_HPP
 #define PAQ8PX_SIMDMIXER_HPP
 
+#include "FinalMixer.hpp"
 #include "Mixer.hpp"
 #include "Squash.hpp"
 
-template<SIMDType simd>
-class SIMDMixer : public Mixer {
+/**
+ * A Mixer with @ref contextSets context sets: when there are more than 1, their outputs are combined by a FinalMixer.
+ */
+template<SIMDType simd, uint32_t contextSets>
+class SIMDMixer final : public Mixer {
 private:
 
     /**
      * Define SIMD padding requirements.
      */
-    [[nodiscard]] constexpr inline auto simdWidth() const -> int {
+    [[nodiscard]] static constexpr auto simdWidth() -> int {
       if( simd == SIMDType::SIMD_AVX2 ) {
         return 32 / sizeof(short); // 256 bit (32 byte) data size
       }
@@ -24,25 +28,87 @@ private:
       assert(false);
     }
 
+    void train(const short *const t, short *const w, const int e) {
+      if (simd == SIMDType::SIMD_NONE) {
+        trainSimdNone(t, w, n, e);
+      }
+      else if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3) {
+        trainSimdSse2(t, w, n, e);
+      }
+      else if (simd == SIMDType::SIMD_AVX2) {
+        trainSimdAvx2(t, w, n, e);
+      }
+      else if (simd == SIMDType::SIMD_NEON) {
+        trainSimdNeon(t, w, n, e);
+      }
+    }
+
+    /**
+     * @return the dot product of the inputs and the weight row of the @ref i-th selected context
+     */
+    auto dotProduct(const uint64_t i) -> int {
+      const short *const w = &wx[cxt[i] * n];
+      if (simd == SIMDType::SIMD_NONE) {
+        return dotProductSimdNone(&tx[0], w, n);
+      }
+      else if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3) {
+        return dotProductSimdSse2(&tx[0], w, n);
+      }
+      else if (simd == SIMDType::SIMD_AVX2) {
+        return dotProductSimdAvx2(&tx[0], w, n);
+      }
+      else if (simd == SIMDType::SIMD_NEON) {
+        return dotProductSimdNeon(&tx[0], w, n);
+      }
+      else {
+        static_assert("Unknown SIMD parameter");
+      }
+    }
+
+    /**
+     * The number of inputs padded to the SIMD width
+     */
+    static constexpr auto paddedInputs(const int n) -> int {
+      return (n + (simdWidth() - 1)) & -(simdWidth());
+    }
+
+    FinalMixer<contextSets> mp; /**< combines the outputs of the context sets */
+
 public:
-  SIMDMixer* mp; /**< points to a Mixer to combine results */
-  
-  SIMDMixer(const Shared* const sh, const int n, const int m, const int s) :
-      Mixer(sh, ((n + (simdWidth() - 1)) & -(simdWidth())), m, s) {
+  SIMDMixer(const Shared* const sh, const int n, const int m) :
+      Mixer(sh, paddedInputs(n), m, contextSets), mp(sh) {
       assert((this->n & (simdWidth() - 1)) == 0);
       assert(this->m > 0);
       assert(this->s > 0);
-      mp = (s > 1) ? new SIMDMixer<simd>(sh, s, 1, 1) : nullptr;
     }
 
-    ~SIMDMixer() {
-      delete mp;
+    /**
+     * Adds the bytes allocated by a SIMDMixer(sh, n, m) to @ref plan
+     */
+    static void planMemory(const int n, const int m, MemoryPlan &plan) {
+      const uint64_t inputs = paddedInputs(n);
+      plan.add(MemoryComponent::Mixer, (inputs * (1 + m)) * sizeof(short) + 3 * contextSets * sizeof(int));
     }
 
     void setScaleFactor(const int sf0, const int sf1) override {
       scaleFactor = sf0;
-      if( mp ) {
-        mp->setScaleFactor(sf1, 0);
+      mp.setScaleFactor(sf1);
+    }
+
+    /**
+     * The weights of the final mixer are padded as if it were a SIMDMixer, so that the snapshots keep their layout.
+     */
+    void saveState(File *f) override {
+      Mixer::saveState(f);
+      if( contextSets > 1 ) {
+        mp.saveState(f, paddedInputs(contextSets));
+      }
+    }
+
+    void loadState(File *f) override {
+      Mixer::loadState(f);
+      if( contextSets > 1 ) {
+        mp.loadState(f, paddedInputs(contextSets));
       }
     }
 
@@ -51,32 +117,22 @@ public:
      * Trains the network where the expected output is the last bit (in the shared variable y).
      */
     void update() override {
-      if (mp)
-        mp->update();
+      if( contextSets > 1 ) {
+        mp.update();
+      }
       INJECT_SHARED_y
       const int target = y << 12;
       for( uint64_t i = 0; i < numContexts; ++i ) {
         int err = target - pr[i];
         int rate = rates[i];
-        if (mp == nullptr) {
+        if (contextSets == 1) {
           if (rate > MIN_LEARNING_RATE_S1) rate--;
         }
         else {
           if (rate > MIN_LEARNING_RATE_SN) rate--;
         }
         rates[i] = rate;
-        if (simd == SIMDType::SIMD_NONE) {
-          trainSimdNone(&tx[0], &wx[cxt[i] * n], n, (err * rate) >> 16);
-        }
-        else if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3) {
-          trainSimdSse2(&tx[0], &wx[cxt[i] * n], n, (err * rate) >> 16);
-        }
-        else if (simd == SIMDType::SIMD_AVX2) {
-          trainSimdAvx2(&tx[0], &wx[cxt[i] * n], n, (err * rate) >> 16);
-        }
-        else if (simd == SIMDType::SIMD_NEON) {
-          trainSimdNeon(&tx[0], &wx[cxt[i] * n], n, (err * rate) >> 16);
-        }
+        train(&tx[0], &wx[cxt[i] * n], (err * rate) >> 16);
       }
       reset();
     }
@@ -89,24 +145,9 @@ public:
       //shared->GetUpdateBroadcaster()->subscribe(this);
       assert(scaleFactor > 0);
       //if(mp)printf("nx: %d, numContexts: %d, base: %d\n",nx, numContexts, base); //for debugging: how many inputs do we have?
-      if( mp ) { // combine outputs
+      if( contextSets > 1 ) { // combine outputs
         for( uint64_t i = 0; i < numContexts; ++i ) {
-          int dp = 0;
-          if (simd == SIMDType::SIMD_NONE) {
-            dp = dotProductSimdNone(&tx[0], &wx[cxt[i] * n], n);
-          }
-          else if (simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3) {
-            dp = dotProductSimdSse2(&tx[0], &wx[cxt[i] * n], n);
-          }
-          else if (simd == SIMDType::SIMD_AVX2) {
-            dp = dotProductSimdAvx2(&tx[0], &wx[cxt[i] * n], n);
-          }
-          else if (simd == SIMDType::SIMD_NEON) {
-            dp = dotProductSimdNeon(&tx[0], &wx[cxt[i] * n], n);
-          }
-          else {
-            static_assert("Unknown SIMD parameter");
-          }
+          int dp = dotProduct(i);
           dp = (dp * scaleFactor) >> 16;
           if (dp < -2047) {
             dp = -2047;
@@ -114,31 +155,14 @@ public:
           else if (dp > 2047) {
             dp = 2047;
           }
-          mp->add(dp);
+          mp.add(dp);
           pr[i] = squash(dp);
         }
-        mp->set(0, 1);
-        return mp->p();
+        return mp.p();
       } // s=1 context
-      int dp;
-      if( simd == SIMDType::SIMD_NONE ) {
-        dp = dotProductSimdNone(&tx[0], &wx[cxt[0] * n], n);
-      }
-      else if( simd == SIMDType::SIMD_SSE2 || simd == SIMDType::SIMD_SSSE3 ) {
-        dp = dotProductSimdSse2(&tx[0], &wx[cxt[0] * n], n);
-      }
-      else if( simd == SIMDType::SIMD_AVX2 ) {
-        dp = dotProductSimdAvx2(&tx[0], &wx[cxt[0] * n], n);
-      }
-      else if (simd == SIMDType::SIMD_NEON) {
-        dp = dotProductSimdNeon(&tx[0], &wx[cxt[0] * n], n);
-      }
-      else {
-        static_assert("Unknown SIMD parameter");
-      }
+      int dp = dotProduct(0);
       dp = (dp * scaleFactor) >> 16;
       return pr[0] = squash(dp);
     }
 };
-
 #endif //PAQ8PX_SIMDMIXER_HPP
\ No newline at end of file
@@ -1,9 +1,15 @@
 #include "StateMap.hpp"
 #include "Utils.hpp"
 
-StateMap::StateMap(const Shared* const sh, const int n, const int lim, const StateMap::MAPTYPE mapType) :
-  shared(sh), numContextsPerSet(n), t(n), limit(lim), cxt(0) {
+StateMap::StateMap(const Shared* const sh, const int n, const int lim, const StateMap::MAPTYPE mapType, const MemoryComponent component) :
+  shared(sh), numContextsPerSet(n), t(n, component), limit(lim), cxt(0) {
   assert(limit > 0 && limit < 1024);
+  if( numContextsPerSet * sizeof(uint32_t) >= (UINT64_C(2) << 20) ) { // a large map (smOrder2)
+    t.place(shared->numaPolicy, shared->numaNode);
+    if( shared->prefaultThreads != 0 ) {
+      t.prefault(shared->prefaultThreads);
+    }
+  }
   dt = DivisionTable::getDT();
   if( mapType == BitHistory ) { // when the context is a bit history byte, we have a-priory for p
     assert((numContextsPerSet & 255) == 0);
@@ -80,6 +86,13 @@ auto StateMap::p1(const uint32_t cx) -> int {
   return t[cx] >> 20;
 }
 
+void StateMap::saveState(File *f) {
+  f->blockWrite(reinterpret_cast<uint8_t *>(&t[0]), t.size() * sizeof(uint32_t));
+}
+
+void StateMap::loadState(File *f) {
+  f->blockReadExact(reinterpret_cast<uint8_t *>(&t[0]), t.size() * sizeof(uint32_t));
+}
 
 void StateMap::print() const {
   for( uint32_t i = 0; i < t.size(); i++ ) {
@@ -4,6 +4,7 @@
 #include "DivisionTable.hpp"
 #include "Shared.hpp"
 #include "StateTable.hpp"
+#include "file/File.hpp"
 
 /**
  * A @ref StateMap maps a context to a probability.
@@ -12,7 +13,7 @@ class StateMap {
 private:
   const Shared* const shared;
   const uint32_t numContextsPerSet; /**< Number of contexts in each context set */
-  Array<uint32_t> t; /**< cxt -> prediction in high 22 bits, count in low 10 bits */
+  Array<uint32_t, 64> t; /**< cxt -> prediction in high 22 bits, count in low 10 bits (cache line aligned) */
   int limit;
   uint32_t cxt; /**< context index of last prediction per context set */
   int* dt; /**< Pointer to division table */
@@ -28,8 +29,9 @@ public:
      * @param n number of contexts
      * @param lim
      * @param mapType
+     * @param component the part of the model it's reported as (see @ref ProgramChecker)
      */
-    StateMap(const Shared* const sh, int n, int lim, MAPTYPE mapType);
+    StateMap(const Shared* const sh, int n, int lim, MAPTYPE mapType, MemoryComponent component = MemoryComponent::StateMaps);
 
     void update();
 
@@ -39,7 +41,20 @@ public:
      */
     auto p1(uint32_t cx) -> int;
 
+    /**
+     * Prefetches the cache line of context @ref cx
+     */
+    void prefetch(const uint32_t cx) const {
+      PREFETCH(&t[cx]);
+    }
+
     void print() const;
+
+    /**
+     * Writes/reads the adaptive state (the probabilities and counts) for a model snapshot.
+     */
+    void saveState(File *f);
+    void loadState(File *f);
 };
 
 #endif //PAQ8PX_STATEMAP_HPP
@@ -39,6 +39,16 @@ static_assert(sizeof(int) == 4, "sizeof(int)");
 #endif
 
 
+// Hint to load the cache line of an address that will be accessed soon
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define PREFETCH(address) _mm_prefetch((const char *) (address), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void) 0)
+#endif
+
 #if defined(NDEBUG)
 #if defined(_MSC_VER)
 #define assume(cond) __assume(cond)
@@ -0,0 +1,117 @@
+// Lookups per second of Bucket16::find() (checksums stored contiguously, compared at once with SSE2) vs the previous
+// layout (7 interleaved checksum+statistics elements, compared one by one), at 3 hash table sizes.
+// The contexts are drawn from a Zipf-like distribution: a few hot ones (hits in slot 0), many warm ones (hits in slots 1..6)
+// and a tail of new ones (empty slots, evictions).
+//
+// Build (from this folder):
+//   g++ -O3 -std=gnu++1z -DNDEBUG Bucket16Bench.cpp ../StateTable.cpp -o bucket16bench
+// Run:
+//   ./bucket16bench [number of distinct contexts, default: 1000000]
+
+#include "../Bucket16.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// The previous bucket layout, for comparison
+class OldBucket16 {
+private:
+#pragma pack(push, 1)
+  struct HashElement {
+    uint16_t checksum;
+    HashElementForContextMap value;
+  };
+#pragma pack(pop)
+  static constexpr int ElementsInBucket = 7;
+  HashElement elements[ElementsInBucket];
+  uint8_t unused {};
+public:
+  void reset() {
+    for( size_t i = 0; i < ElementsInBucket; i++ ) {
+      elements[i] = {};
+    }
+  }
+
+  HashElementForContextMap *find(uint16_t checksum) {
+    checksum += checksum == 0;
+    if( elements[0].checksum == checksum ) {
+      return &elements[0].value;
+    }
+    uint8_t minPrio = 255;
+    size_t minElementIdx = 1;
+    for( size_t i = 1; i < ElementsInBucket; ++i ) {
+      if( elements[i].checksum == checksum ) {
+        HashElementForContextMap value = elements[i].value;
+        memmove(&elements[1], &elements[0], i * sizeof(HashElement));
+        elements[0].checksum = checksum;
+        elements[0].value = value;
+        return &elements[0].value;
+      }
+      if( elements[i].checksum == 0 ) {
+        memmove(&elements[1], &elements[0], i * sizeof(HashElement));
+        goto create_element;
+      }
+      const uint8_t thisPrio = elements[i].value.prio();
+      if( thisPrio < minPrio ) {
+        minPrio = thisPrio;
+        minElementIdx = i;
+      }
+    }
+    memmove(&elements[1], &elements[0], minElementIdx * sizeof(HashElement));
+  create_element:
+    elements[0].checksum = checksum;
+    elements[0].value = {};
+    return &elements[0].value;
+  }
+};
+
+static std::vector<uint32_t> keys;
+
+// best of 5 runs, in million lookups per second
+template<class B, class F>
+static auto run(const uint32_t buckets, F find) -> double {
+  std::vector<B> table(buckets);
+  double best = 1e9;
+  uint64_t sum = 0;
+  for( int rep = 0; rep < 5; rep++ ) {
+    for( auto &b: table ) {
+      b.reset();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for( const uint32_t k: keys ) {
+      HashElementForContextMap *const p = find(table[(k >> 16U) & (buckets - 1)], uint16_t(k));
+      p->bitState += 1 + (k & 7U);
+      sum += p->bitState;
+    }
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  if( sum == 0 ) {
+    printf("-");
+  }
+  return keys.size() / best / 1e6;
+}
+
+auto main(int argc, char **argv) -> int {
+  const uint32_t distinct = argc > 1 ? uint32_t(strtoul(argv[1], nullptr, 10)) : 1000000;
+  std::mt19937 rng(1);
+  std::vector<uint32_t> contexts(distinct);
+  for( auto &c: contexts ) {
+    c = rng();
+  }
+  keys.resize(1U << 23U);
+  for( auto &k: keys ) {
+    const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    k = contexts[uint32_t(distinct * u * u * u) % distinct];
+  }
+  static_assert(sizeof(Bucket16) == 64 && sizeof(OldBucket16) == 64, "a bucket is a cache line");
+  for( const uint32_t buckets: {1U << 12U, 1U << 16U, 1U << 20U} ) {
+    const double o = run<OldBucket16>(buckets, [](OldBucket16 &b, uint16_t c) { return b.find(c); });
+    const double n = run<Bucket16>(buckets, [](Bucket16 &b, uint16_t c) { return b.find<SIMDType::SIMD_NONE>(c); });
+    const double s = run<Bucket16>(buckets, [](Bucket16 &b, uint16_t c) { return b.find<SIMDType::SIMD_SSE2>(c); });
+    printf("%8u buckets (%6u KB), %u contexts: old %6.1f, NONE %6.1f, SSE2 %6.1f M lookups/s\n", buckets, buckets >> 4U, distinct, o, n, s);
+  }
+  return 0;
+}
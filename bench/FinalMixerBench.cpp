@@ -0,0 +1,60 @@
+// Cost per bit of the final mixer layer, which combines the outputs of the 4 context sets: FinalMixer<4> vs a
+// SIMDMixer<simd, 1>(sh, 4, 1), the padded single-row mixer it replaced (16 inputs with AVX2, 8 with SSE2).
+// 4 random inputs per bit, best of 3 runs; the times include the generation of the inputs and the bits.
+//
+// Build (from this folder):
+//   g++ -O3 -std=gnu++1z -DNDEBUG FinalMixerBench.cpp ../Mixer.cpp ../Shared.cpp ../Squash.cpp ../Allocation.cpp ../ProgramChecker.cpp ../String.cpp ../file/File.cpp ../file/FileDisk.cpp -o finalmixerbench
+// Run:
+//   ./finalmixerbench [bits, default: 50000000]
+
+#include "../SimdMixer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// @return ns per bit, the sum of the predictions in @ref sum
+template<class M, bool padded>
+static auto run(M &mixer, Shared &shared, const uint32_t bits, int64_t &sum) -> double {
+  uint32_t r = 12345;
+  sum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for( uint32_t i = 0; i < bits; i++ ) {
+    for( int k = 0; k < 4; k++ ) {
+      r = r * 1664525U + 1013904223U;
+      mixer.add(int(r >> 21U) - 1024);
+    }
+    if constexpr( padded ) {
+      mixer.set(0, 1);
+    }
+    const int p = mixer.p();
+    r = r * 1664525U + 1013904223U;
+    shared.State.y = (r >> 20U) < uint32_t(p) ? 1 : 0;
+    sum += p;
+    mixer.update();
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / bits;
+}
+
+auto main(int argc, char **argv) -> int {
+  const uint32_t bits = argc > 1 ? uint32_t(strtoul(argv[1], nullptr, 10)) : 50000000;
+  Shared shared;
+  shared.init(1);
+  double avx2 = 1e9, sse2 = 1e9, finalMixer = 1e9;
+  bool same = true;
+  for( int rep = 0; rep < 3; rep++ ) {
+    int64_t sumAvx2, sumSse2, sumFinalMixer;
+    SIMDMixer<SIMDType::SIMD_AVX2, 1> a(&shared, 4, 1);
+    a.setScaleFactor(240, 0);
+    SIMDMixer<SIMDType::SIMD_SSE2, 1> b(&shared, 4, 1);
+    b.setScaleFactor(240, 0);
+    FinalMixer<4> f(&shared);
+    f.setScaleFactor(240);
+    avx2 = std::min(avx2, run<decltype(a), true>(a, shared, bits, sumAvx2));
+    sse2 = std::min(sse2, run<decltype(b), true>(b, shared, bits, sumSse2));
+    finalMixer = std::min(finalMixer, run<decltype(f), false>(f, shared, bits, sumFinalMixer));
+    same = same && sumAvx2 == sumFinalMixer && sumSse2 == sumFinalMixer;
+  }
+  printf("ns/bit: padded SIMDMixer AVX2 %.2f, SSE2 %.2f, FinalMixer<4> %.2f (same predictions: %d)\n", avx2, sse2, finalMixer, int(same));
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Per-byte cost of the byte I/O of the coder and of the (de)compression loops: a virtual File::getchar()/putChar()
+// per byte (as before BufferedReader/BufferedWriter) vs the inlined BufferedReader::getchar()/BufferedWriter::putChar().
+// Per input byte, compression reads the byte and writes about ARCHIVE_BYTES of archive (-1 on text), decompression the reverse.
+//
+// Build (from this folder):
+//   g++ -O3 -std=gnu++1z -DNDEBUG -pthread IoBench.cpp ../file/File.cpp ../file/FileDisk.cpp ../Allocation.cpp ../ProgramChecker.cpp ../String.cpp -o iobench
+// Run:
+//   ./iobench [temporary file name, default: iobench.tmp] [megabytes, default: 200]
+
+#include "../file/BufferedReader.hpp"
+#include "../file/BufferedWriter.hpp"
+#include "../file/FileDisk.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static constexpr double ARCHIVE_BYTES = 0.1;
+
+static auto now() -> std::chrono::steady_clock::time_point { return std::chrono::steady_clock::now(); }
+
+static auto nsPerByte(const std::chrono::steady_clock::time_point start, const uint64_t n) -> double {
+  return std::chrono::duration<double, std::nano>(now() - start).count() / n;
+}
+
+auto main(int argc, char **argv) -> int {
+  const char *name = argc > 1 ? argv[1] : "iobench.tmp";
+  const uint64_t n = (argc > 2 ? strtoull(argv[2], nullptr, 10) : 200) << 20;
+  uint64_t sum = 0;
+  double virtualPut, bufferedPut, virtualGet, bufferedGet;
+  {
+    FileDisk f;
+    f.create(name);
+    File *file = &f;
+    const auto start = now();
+    for( uint64_t i = 0; i < n; i++ ) {
+      file->putChar(static_cast<uint8_t>(i));
+    }
+    f.close();
+    virtualPut = nsPerByte(start, n);
+  }
+  {
+    FileDisk f;
+    f.create(name);
+    BufferedWriter out(&f);
+    const auto start = now();
+    for( uint64_t i = 0; i < n; i++ ) {
+      out.putChar(static_cast<uint8_t>(i));
+    }
+    out.flush();
+    f.close();
+    bufferedPut = nsPerByte(start, n);
+  }
+  {
+    FileDisk f;
+    f.open(name, true);
+    File *file = &f;
+    const auto start = now();
+    for( uint64_t i = 0; i < n; i++ ) {
+      sum += file->getchar();
+    }
+    f.close();
+    virtualGet = nsPerByte(start, n);
+  }
+  {
+    FileDisk f;
+    f.open(name, true);
+    BufferedReader in(&f);
+    const auto start = now();
+    for( uint64_t i = 0; i < n; i++ ) {
+      sum += in.getchar();
+    }
+    f.close();
+    bufferedGet = nsPerByte(start, n);
+  }
+  remove(name);
+  printf("%" PRIu64 " MB, ns per byte:\n", n >> 20);
+  printf("  putChar: virtual %.2f, buffered %.2f\n", virtualPut, bufferedPut);
+  printf("  getchar: virtual %.2f, buffered %.2f\n", virtualGet, bufferedGet);
+  // per input byte, compression reads a byte and writes the archive (about 0.1 byte at -1 on text), decompression the reverse
+  printf("  removed per input byte at -1: compression %.2f, decompression %.2f (checksum %" PRIu64 ")\n",
+         (virtualGet - bufferedGet) + ARCHIVE_BYTES * (virtualPut - bufferedPut), (virtualPut - bufferedPut) + ARCHIVE_BYTES * (virtualGet - bufferedGet), sum);
+  return 0;
+}
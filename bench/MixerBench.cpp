@@ -0,0 +1,170 @@
+// Cost per bit of the training and the dot products of the first mixer layer, best of 5 runs: trainSimdX() of the rows of
+// the last bit followed by dotProductSimdX() of the rows of this bit (as SIMDMixer does), vs trainDotProductSimdX() below,
+// which trains a row and computes its next dot product in a single pass, for the rows that are selected again.
+// The sizes are those of NormalModel: 33 inputs padded to the width of the instruction set, 4 context sets and 30561
+// weight rows, and a row is selected again with probability 1/3 (as measured at -4 on text).
+//
+// Build (from this folder):
+//   g++ -O3 -std=gnu++1z -DNDEBUG MixerBench.cpp -o mixerbench
+// Run:
+//   ./mixerbench [bits, default: 10000000]
+
+#include "../Mixer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (!defined(__ARM_FEATURE_SIMD32) && !defined(__ARM_NEON))
+__attribute__((target("avx2")))
+#endif
+/**
+ * trainSimdAvx2(t, w, n, e) followed by dotProductSimdAvx2(tNext, w, n) in a single pass over the weights
+ */
+static auto trainDotProductSimdAvx2(const short *const t, const short *const tNext, short *const w, int n, const int e) -> int {
+#if !defined(__i386__) && !defined(__x86_64__) && !defined(_M_X64)
+  return 0;
+#else
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i err = _mm256_set1_epi16(short(e));
+  __m256i sum = _mm256_setzero_si256();
+
+  while((n -= 16) >= 0 ) {
+    __m256i tmp = _mm256_adds_epi16(*(__m256i * ) & t[n], *(__m256i * ) & t[n]);
+    tmp = _mm256_mulhi_epi16(tmp, err);
+    tmp = _mm256_adds_epi16(tmp, one);
+    tmp = _mm256_srai_epi16(tmp, 1);
+    tmp = _mm256_adds_epi16(tmp, *reinterpret_cast<__m256i *>(&w[n]));
+    *reinterpret_cast<__m256i *>(&w[n]) = tmp;
+    __m256i dot = _mm256_madd_epi16(*(__m256i * ) & tNext[n], tmp);
+    dot = _mm256_srai_epi32(dot, 8);
+    sum = _mm256_add_epi32(sum, dot);
+  }
+
+  __m128i lo = _mm256_extractf128_si256(sum, 0);
+  __m128i hi = _mm256_extractf128_si256(sum, 1);
+
+  __m128i newSum = _mm_hadd_epi32(lo, hi);
+  newSum = _mm_add_epi32(newSum, _mm_srli_si128(newSum, 8));
+  newSum = _mm_add_epi32(newSum, _mm_srli_si128(newSum, 4));
+  return _mm_cvtsi128_si32(newSum);
+#endif
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (!defined(__ARM_FEATURE_SIMD32) && !defined(__ARM_NEON))
+__attribute__((target("sse2")))
+#endif
+/**
+ * trainSimdSse2(t, w, n, e) followed by dotProductSimdSse2(tNext, w, n) in a single pass over the weights
+ */
+static auto trainDotProductSimdSse2(const short *const t, const short *const tNext, short *const w, int n, const int e) -> int {
+#if !defined(__i386__) && !defined(__x86_64__) && !defined(_M_X64)
+  return 0;
+#else
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i err = _mm_set1_epi16(short(e));
+  __m128i sum = _mm_setzero_si128();
+
+  while((n -= 8) >= 0 ) {
+    __m128i tmp = _mm_adds_epi16(*(__m128i * ) & t[n], *(__m128i * ) & t[n]);
+    tmp = _mm_mulhi_epi16(tmp, err);
+    tmp = _mm_adds_epi16(tmp, one);
+    tmp = _mm_srai_epi16(tmp, 1);
+    tmp = _mm_adds_epi16(tmp, *reinterpret_cast<__m128i *>(&w[n]));
+    *reinterpret_cast<__m128i *>(&w[n]) = tmp;
+    __m128i dot = _mm_madd_epi16(*(__m128i * ) & tNext[n], tmp);
+    dot = _mm_srai_epi32(dot, 8);
+    sum = _mm_add_epi32(sum, dot);
+  }
+
+  sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+  sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+  return _mm_cvtsi128_si32(sum);
+#endif
+}
+
+static constexpr int INPUTS = 33;
+static constexpr int SETS = 4;
+static constexpr int ROWS = 30561;
+static constexpr int INPUT_VECTORS = 4096;
+
+struct Kernels {
+  const char *name;
+  int width; // in shorts
+  void (*train)(const short *t, short *w, int n, int e);
+  int (*dotProduct)(const short *t, const short *w, int n);
+  int (*trainDotProduct)(const short *t, const short *tNext, short *w, int n, int e); // nullptr: none
+};
+
+static uint32_t rnd = 12345;
+
+static auto next() -> uint32_t {
+  rnd = rnd * 1664525U + 1013904223U;
+  return rnd >> 8U;
+}
+
+// @return ns per bit, the sum of the dot products in @ref check
+static auto run(const Kernels &k, const bool fused, const uint32_t bits, int64_t &check) -> double {
+  const int n = (INPUTS + k.width - 1) / k.width * k.width;
+  alignas(32) static short weights[ROWS * 64];
+  alignas(32) static short inputs[INPUT_VECTORS][64];
+  rnd = 12345;
+  for( auto &t: inputs ) {
+    for( int i = 0; i < INPUTS; i++ ) {
+      t[i] = short(int(next() & 4095U) - 2048);
+    }
+  }
+  std::fill(weights, weights + ROWS * n, short(16384 / INPUTS));
+  uint32_t rows[SETS] {}, lastRows[SETS] {};
+  int errors[SETS] {};
+  bool pending = false;
+  check = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for( uint32_t bit = 0; bit < bits; bit++ ) {
+    const short *const t = inputs[bit % INPUT_VECTORS], *const tLast = inputs[(bit - 1) % INPUT_VECTORS];
+    for( int i = 0; i < SETS; i++ ) { // the context sets select from distinct ranges of rows
+      rows[i] = next() % 3 == 0 ? lastRows[i] : i * (ROWS / SETS) + next() % (ROWS / SETS);
+    }
+    for( int i = 0; i < SETS; i++ ) {
+      if( pending && (!fused || rows[i] != lastRows[i]) ) {
+        k.train(tLast, &weights[lastRows[i] * n], n, errors[i]);
+      }
+    }
+    for( int i = 0; i < SETS; i++ ) {
+      short *const w = &weights[rows[i] * n];
+      const int dp = pending && fused && rows[i] == lastRows[i] ? k.trainDotProduct(tLast, t, w, n, errors[i]) : k.dotProduct(t, w, n);
+      check += dp;
+      errors[i] = int(next() & 255U) - 128;
+      lastRows[i] = rows[i];
+    }
+    pending = true;
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / bits;
+}
+
+auto main(int argc, char **argv) -> int {
+  const uint32_t bits = argc > 1 ? uint32_t(strtoul(argv[1], nullptr, 10)) : 10000000;
+  const Kernels kernels[] = {
+    {"NONE", 2, trainSimdNone, dotProductSimdNone, nullptr},
+    {"SSE2", 8, trainSimdSse2, dotProductSimdSse2, trainDotProductSimdSse2},
+    {"AVX2", 16, trainSimdAvx2, dotProductSimdAvx2, trainDotProductSimdAvx2},
+  };
+  for( const Kernels &k: kernels ) { // best of 5 interleaved runs
+    double separate = 1e9, fused = 1e9;
+    int64_t separateCheck, fusedCheck = 0;
+    for( int rep = 0; rep < 5; rep++ ) {
+      separate = std::min(separate, run(k, false, bits, separateCheck));
+      if( k.trainDotProduct != nullptr ) {
+        fused = std::min(fused, run(k, true, bits, fusedCheck));
+      }
+    }
+    if( k.trainDotProduct == nullptr ) {
+      printf("%s: separate %.2f ns/bit\n", k.name, separate);
+    }
+    else {
+      printf("%s: separate %.2f, fused %.2f ns/bit (same output: %d)\n", k.name, separate, fused, int(separateCheck == fusedCheck));
+    }
+  }
+  return 0;
+}
@@ -1 +1,16 @@
-g++ -fno-rtti -std=gnu++1z -DNDEBUG -O3 -m64 -march=native -mtune=native -flto -fwhole-program  ../file/*.cpp ../model/*.cpp ../*.cpp -opaq8px-lite-t1.exe
\ No newline at end of file
+# Builds a single executable for all x86-64 CPUs (a "fat binary").
+# The whole program is compiled for each x86-64 microarchitecture level (x86-64, x86-64-v2, x86-64-v3) as a variant.
+# A variant is a single translation unit compiled with -fwhole-program: only its entry point (processCommandLine_x86_64_v1..v3)
+# is global, so the variants can't mix. The launcher runs the variant of the CPU at startup (see isaLevelDetect()).
+# For a build that runs only on the build machine compile with: -march=native -mtune=native -flto -fwhole-program
+set -e
+options="-fno-rtti -std=gnu++1z -pthread -DNDEBUG -O3 -m64 -mtune=generic"
+for level in v1 v2 v3; do
+  variant=x86_64_$level
+  march=x86-64-$level
+  if [ $level = v1 ]; then march=x86-64; fi
+  for f in ../file/*.cpp ../model/*.cpp ../*.cpp; do echo "#include \"$f\""; done > paq8px-$variant.cpp
+  g++ $options -march=$march -fwhole-program -DISA_VARIANT=$variant -c paq8px-$variant.cpp -opaq8px-$variant.o
+done
+g++ $options -march=x86-64 -DFAT_BINARY ../paq8px.cpp paq8px-x86_64_v1.o paq8px-x86_64_v2.o paq8px-x86_64_v3.o -opaq8px-lite-t1.exe
+rm paq8px-x86_64_v1.* paq8px-x86_64_v2.* paq8px-x86_64_v3.*
@@ -0,0 +1,134 @@
+#include "AsyncReader.hpp"
+
+AsyncReader::AsyncReader(File *f) : file(f) {}
+
+AsyncReader::~AsyncReader() { stopThread(); }
+
+void AsyncReader::run() {
+  try {
+    const uint32_t chunkSize = ring.getChunkSize();
+    uint32_t spins = 0;
+    while( !stopRequested.load(std::memory_order_relaxed) ) {
+      if( !ring.canProduce() ) {
+        ChunkRing::pause(spins);
+        continue;
+      }
+      spins = 0;
+      const uint64_t n = file->blockRead(ring.producerChunk(), chunkSize);
+      if( n > 0 ) {
+        ring.produce(static_cast<uint32_t>(n));
+      }
+      if( n < chunkSize ) { // end of file
+        break;
+      }
+    }
+  }
+  catch( IntentionalException const & ) {
+    failed = true;
+  }
+  ring.close();
+}
+
+void AsyncReader::start() {
+  assert(!thread.joinable());
+  if( ring.getChunkSize() == 0 ) {
+    ring.init(8, 256 * 1024);
+  }
+  ring.reset();
+  hasChunk = false;
+  eofReached = false;
+  position = file->curPos();
+  thread = std::thread(&AsyncReader::run, this);
+}
+
+void AsyncReader::stopThread() {
+  if( thread.joinable() ) {
+    stopRequested.store(true, std::memory_order_relaxed);
+    thread.join();
+    stopRequested.store(false, std::memory_order_relaxed);
+  }
+}
+
+auto AsyncReader::acquireChunk() -> bool {
+  if( hasChunk ) {
+    return true;
+  }
+  if( !ring.canConsume() ) {
+    const auto waitStart = std::chrono::steady_clock::now();
+    uint32_t spins = 0;
+    while( !ring.canConsume() && !ring.isClosed() ) {
+      ChunkRing::pause(spins);
+    }
+    ProgramChecker::getInstance()->addIoWaitTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count());
+    if( !ring.canConsume() ) { // closed
+      if( failed ) {
+        quit();
+      }
+      return false;
+    }
+  }
+  hasChunk = true;
+  chunkPos = 0;
+  return true;
+}
+
+auto AsyncReader::open(const char * /*filename*/, bool /*mustSucceed*/) -> bool {
+  assert(false); // it reads an already open file
+  return false;
+}
+
+void AsyncReader::create(const char * /*filename*/) {
+  assert(false); // read only
+}
+
+void AsyncReader::close() { stopThread(); }
+
+auto AsyncReader::getchar() -> int {
+  uint8_t c = 0;
+  return blockRead(&c, 1) == 1 ? c : EOF;
+}
+
+void AsyncReader::putChar(uint8_t /*c*/) {
+  assert(false); // read only
+}
+
+auto AsyncReader::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  uint64_t done = 0;
+  while( done < count ) {
+    if( !acquireChunk() ) {
+      eofReached = true;
+      break;
+    }
+    const uint32_t chunkSize = ring.consumerSize();
+    const uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(count - done, chunkSize - chunkPos));
+    memcpy(&ptr[done], &ring.consumerChunk()[chunkPos], n);
+    chunkPos += n;
+    done += n;
+    if( chunkPos == chunkSize ) {
+      ring.consume();
+      hasChunk = false;
+    }
+  }
+  position += done;
+  return done;
+}
+
+void AsyncReader::blockWrite(uint8_t * /*ptr*/, uint64_t /*count*/) {
+  assert(false); // read only
+}
+
+void AsyncReader::setpos(uint64_t newPos) {
+  stopThread();
+  file->setpos(newPos);
+  start();
+}
+
+void AsyncReader::setEnd() {
+  stopThread();
+  file->setEnd();
+  start();
+}
+
+auto AsyncReader::curPos() -> uint64_t { return position; }
+
+auto AsyncReader::eof() -> bool { return eofReached; }
@@ -0,0 +1,56 @@
+#ifndef PAQ8PX_ASYNCREADER_HPP
+#define PAQ8PX_ASYNCREADER_HPP
+
+#include "ChunkRing.hpp"
+#include "File.hpp"
+#include <atomic>
+#include <thread>
+
+/**
+ * Reads a @ref File ahead on a separate thread, so that the coding thread doesn't wait for the disk
+ * (only for the reader thread when that falls behind: this time is reported to @ref ProgramChecker).
+ * Until start() is called it does nothing. While it runs, the underlying file must not be used directly.
+ * setpos() restarts reading at the new position.
+ */
+class AsyncReader : public File {
+private:
+    File *file;
+    ChunkRing ring;
+    std::thread thread;
+    std::atomic<bool> stopRequested {false};
+    bool failed {}; /**< the reader thread gave up, the message is already printed */
+    bool hasChunk {}; /**< the consumer holds a chunk */
+    uint32_t chunkPos {}; /**< next byte to read in the chunk held */
+    uint64_t position {}; /**< bytes read from the underlying file so far by the coding thread */
+    bool eofReached {};
+
+    void run();
+    void stopThread();
+    auto acquireChunk() -> bool;
+
+public:
+    explicit AsyncReader(File *f);
+    ~AsyncReader() override;
+
+    /**
+     * Starts reading ahead from the current position of the underlying file.
+     */
+    void start();
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+    void create(const char *filename) override;
+
+    /**
+     * Stops the reader thread. The underlying file is not closed.
+     */
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+};
+
+#endif //PAQ8PX_ASYNCREADER_HPP
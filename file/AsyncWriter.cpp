@@ -0,0 +1,132 @@
+#include "AsyncWriter.hpp"
+
+AsyncWriter::AsyncWriter(File *f) : file(f) {}
+
+AsyncWriter::~AsyncWriter() {
+  if( thread.joinable() ) { // not closed (we are quitting): let the writer thread finish
+    ring.close();
+    thread.join();
+  }
+}
+
+void AsyncWriter::run() {
+  try {
+    uint32_t spins = 0;
+    while( !ring.isClosed() ) {
+      if( !ring.canConsume() ) {
+        ChunkRing::pause(spins);
+        continue;
+      }
+      spins = 0;
+      file->blockWrite(ring.consumerChunk(), ring.consumerSize());
+      ring.consume();
+    }
+  }
+  catch( IntentionalException const & ) {
+    failed = true;
+    while( !ring.isClosed() ) { // discard the rest so that the coding thread can finish
+      if( ring.canConsume() ) {
+        ring.consume();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+void AsyncWriter::start() {
+  assert(!thread.joinable());
+  if( ring.getChunkSize() == 0 ) {
+    ring.init(8, 256 * 1024);
+  }
+  ring.reset();
+  chunkPos = 0;
+  position = file->curPos();
+  thread = std::thread(&AsyncWriter::run, this);
+}
+
+void AsyncWriter::waitForChunk() {
+  if( !ring.canProduce() ) {
+    const auto waitStart = std::chrono::steady_clock::now();
+    uint32_t spins = 0;
+    while( !ring.canProduce() ) {
+      ChunkRing::pause(spins);
+    }
+    ProgramChecker::getInstance()->addIoWaitTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count());
+  }
+}
+
+auto AsyncWriter::open(const char * /*filename*/, bool /*mustSucceed*/) -> bool {
+  assert(false); // it writes an already open file
+  return false;
+}
+
+void AsyncWriter::create(const char * /*filename*/) {
+  assert(false); // it writes an already open file
+}
+
+void AsyncWriter::close() {
+  if( !thread.joinable() ) {
+    return;
+  }
+  if( chunkPos != 0 ) {
+    waitForChunk();
+    ring.produce(chunkPos);
+    chunkPos = 0;
+  }
+  ring.close();
+  const auto waitStart = std::chrono::steady_clock::now();
+  thread.join();
+  ProgramChecker::getInstance()->addIoWaitTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count());
+  if( failed ) {
+    quit();
+  }
+}
+
+auto AsyncWriter::getchar() -> int {
+  assert(false); // write only
+  return EOF;
+}
+
+void AsyncWriter::putChar(uint8_t c) {
+  blockWrite(&c, 1);
+}
+
+auto AsyncWriter::blockRead(uint8_t * /*ptr*/, uint64_t /*count*/) -> uint64_t {
+  assert(false); // write only
+  return 0;
+}
+
+void AsyncWriter::blockWrite(uint8_t *ptr, uint64_t count) {
+  const uint32_t chunkSize = ring.getChunkSize();
+  position += count;
+  while( count > 0 ) {
+    if( chunkPos == 0 ) {
+      waitForChunk();
+    }
+    const uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(count, chunkSize - chunkPos));
+    memcpy(&ring.producerChunk()[chunkPos], ptr, n);
+    chunkPos += n;
+    ptr += n;
+    count -= n;
+    if( chunkPos == chunkSize ) {
+      ring.produce(chunkSize);
+      chunkPos = 0;
+    }
+  }
+  if( failed ) {
+    quit();
+  }
+}
+
+void AsyncWriter::setpos(uint64_t /*newPos*/) {
+  assert(false); // sequential only
+}
+
+void AsyncWriter::setEnd() {
+  assert(false); // sequential only
+}
+
+auto AsyncWriter::curPos() -> uint64_t { return position; }
+
+auto AsyncWriter::eof() -> bool { return false; }
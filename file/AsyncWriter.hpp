@@ -0,0 +1,51 @@
+#ifndef PAQ8PX_ASYNCWRITER_HPP
+#define PAQ8PX_ASYNCWRITER_HPP
+
+#include "ChunkRing.hpp"
+#include "File.hpp"
+#include <thread>
+
+/**
+ * Writes a @ref File on a separate thread, so that the coding thread doesn't wait for the disk
+ * (only for the writer thread when that falls behind: this time is reported to @ref ProgramChecker).
+ * Until start() is called it does nothing. While it runs, the underlying file must not be used directly.
+ * It can only be written sequentially; close() must be called before the underlying file is closed.
+ */
+class AsyncWriter : public File {
+private:
+    File *file;
+    ChunkRing ring;
+    std::thread thread;
+    bool failed {}; /**< the writer thread gave up, the message is already printed */
+    uint32_t chunkPos {}; /**< number of bytes in the chunk being filled */
+    uint64_t position {}; /**< bytes written by the coding thread so far */
+
+    void run();
+    void waitForChunk();
+
+public:
+    explicit AsyncWriter(File *f);
+    ~AsyncWriter() override;
+
+    /**
+     * Starts writing at the current position of the underlying file.
+     */
+    void start();
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+    void create(const char *filename) override;
+
+    /**
+     * Writes the rest and stops the writer thread. The underlying file is not closed.
+     */
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+};
+
+#endif //PAQ8PX_ASYNCWRITER_HPP
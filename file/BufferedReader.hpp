@@ -0,0 +1,49 @@
+#ifndef PAQ8PX_BUFFEREDREADER_HPP
+#define PAQ8PX_BUFFEREDREADER_HPP
+
+#include "File.hpp"
+#include "../Array.hpp"
+#include "../SystemDefines.hpp"
+
+/**
+ * Reads a @ref File sequentially in blocks, so that reading a byte is an inlined, non-virtual call.
+ * It reads ahead: when the file is positioned (or read) directly, reset() must be called.
+ */
+class BufferedReader {
+private:
+    File *file;
+    Array<uint8_t> buffer;
+    uint32_t bufferPos {}; /**< next byte to return */
+    uint32_t bufferEnd {}; /**< number of valid bytes in buffer */
+
+    void refill() {
+      bufferPos = 0;
+      bufferEnd = static_cast<uint32_t>(file->blockRead(&buffer[0], buffer.size()));
+    }
+
+public:
+    explicit BufferedReader(File *f, const uint32_t size = 65536) : file(f), buffer(size) {}
+
+    /**
+     * @return the next byte, or EOF at the end of the file
+     */
+    ALWAYS_INLINE auto getchar() -> int {
+      if( bufferPos == bufferEnd ) {
+        refill();
+        if( bufferEnd == 0 ) {
+          return EOF;
+        }
+      }
+      return buffer[bufferPos++];
+    }
+
+    /**
+     * Discards the bytes read ahead.
+     */
+    void reset() {
+      bufferPos = 0;
+      bufferEnd = 0;
+    }
+};
+
+#endif //PAQ8PX_BUFFEREDREADER_HPP
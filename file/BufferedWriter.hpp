@@ -0,0 +1,41 @@
+#ifndef PAQ8PX_BUFFEREDWRITER_HPP
+#define PAQ8PX_BUFFEREDWRITER_HPP
+
+#include "File.hpp"
+#include "../Array.hpp"
+#include "../SystemDefines.hpp"
+
+/**
+ * Writes a @ref File sequentially in blocks, so that writing a byte is an inlined, non-virtual call.
+ * flush() must be called before the file is used directly (and before it is closed).
+ */
+class BufferedWriter {
+private:
+    File *file;
+    Array<uint8_t> buffer;
+    uint32_t bufferPos {}; /**< number of bytes in buffer */
+
+public:
+    explicit BufferedWriter(File *f, const uint32_t size = 65536) : file(f), buffer(size) {}
+
+    ALWAYS_INLINE void putChar(const uint8_t c) {
+      if( bufferPos == buffer.size() ) {
+        flush();
+      }
+      buffer[bufferPos++] = c;
+    }
+
+    /**
+     * @return the number of bytes written but not yet flushed to the file
+     */
+    [[nodiscard]] auto pending() const -> uint32_t { return bufferPos; }
+
+    void flush() {
+      if( bufferPos != 0 ) {
+        file->blockWrite(&buffer[0], bufferPos);
+        bufferPos = 0;
+      }
+    }
+};
+
+#endif //PAQ8PX_BUFFEREDWRITER_HPP
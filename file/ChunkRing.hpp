@@ -0,0 +1,107 @@
+#ifndef PAQ8PX_CHUNKRING_HPP
+#define PAQ8PX_CHUNKRING_HPP
+
+#include "../Array.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/**
+ * A lock-free single-producer/single-consumer ring of fixed size chunks for handing over data
+ * between two threads. The producer fills producerChunk() and publishes it with produce(), the
+ * consumer reads consumerChunk() and gives it back with consume(). The producer may close() the
+ * ring: the consumer sees it through isClosed() after all chunks are consumed.
+ * Waiting for a free or a filled chunk is up to the caller (see pause()).
+ */
+class ChunkRing {
+private:
+    Array<uint8_t, 64> buffer {0};
+    Array<uint32_t> sizes {0}; /**< number of bytes in each chunk */
+    uint32_t chunkCount {};
+    uint32_t chunkSize {};
+    alignas(64) std::atomic<uint64_t> head {0}; /**< number of chunks produced */
+    alignas(64) std::atomic<uint64_t> tail {0}; /**< number of chunks consumed */
+    std::atomic<bool> closed {false};
+
+public:
+    /**
+     * Allocates the ring. Must not be called while the ring is in use.
+     */
+    void init(const uint32_t count, const uint32_t size) {
+      chunkCount = count;
+      chunkSize = size;
+      buffer.resize(static_cast<uint64_t>(count) * size);
+      sizes.resize(count);
+      reset();
+    }
+
+    /**
+     * Empties the ring. Must not be called while the ring is in use.
+     */
+    void reset() {
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+      closed.store(false, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto getChunkSize() const -> uint32_t { return chunkSize; }
+
+    // producer side
+
+    [[nodiscard]] auto canProduce() const -> bool {
+      return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) < chunkCount;
+    }
+
+    auto producerChunk() -> uint8_t * {
+      return &buffer[(head.load(std::memory_order_relaxed) % chunkCount) * chunkSize];
+    }
+
+    void produce(const uint32_t size) {
+      const uint64_t h = head.load(std::memory_order_relaxed);
+      sizes[h % chunkCount] = size;
+      head.store(h + 1, std::memory_order_release);
+    }
+
+    void close() {
+      closed.store(true, std::memory_order_release);
+    }
+
+    // consumer side
+
+    [[nodiscard]] auto canConsume() const -> bool {
+      return head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return true when the producer closed the ring and all its chunks are consumed
+     */
+    [[nodiscard]] auto isClosed() const -> bool {
+      return closed.load(std::memory_order_acquire) && !canConsume();
+    }
+
+    auto consumerChunk() -> uint8_t * {
+      return &buffer[(tail.load(std::memory_order_relaxed) % chunkCount) * chunkSize];
+    }
+
+    [[nodiscard]] auto consumerSize() const -> uint32_t {
+      return sizes[tail.load(std::memory_order_relaxed) % chunkCount];
+    }
+
+    void consume() {
+      tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Waits a little while the other side catches up: spins first, then sleeps.
+     * @param spins the number of times pause() was called in the same wait, set it to 0 before waiting
+     */
+    static void pause(uint32_t &spins) {
+      if( spins++ < 64 ) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+};
+
+#endif //PAQ8PX_CHUNKRING_HPP
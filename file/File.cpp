@@ -14,7 +14,7 @@ auto File::getVLI() -> uint64_t {
     b = getchar();
     i |= uint64_t(b & 0x7FU) << k;
     k += 7;
-  } while((b >> 7U) > 0 );
+  } while((b >> 7U) > 0 && k < 64); // stop at EOF (or corruption) after 64 bits
   return i;
 }
 
@@ -25,3 +25,23 @@ void File::putVLI(uint64_t i) {
   }
   putChar(uint8_t(i));
 }
+
+void File::blockReadExact(uint8_t *ptr, uint64_t count) {
+  if( blockRead(ptr, count) != count ) {
+    quit("Unexpected end of file.");
+  }
+}
+
+auto File::get64() -> uint64_t {
+  uint64_t i = 0;
+  for( int k = 0; k < 8; k++ ) {
+    i = (i << 8U) | (getchar() & 0xFFU);
+  }
+  return i;
+}
+
+void File::put64(uint64_t i) {
+  for( int k = 56; k >= 0; k -= 8 ) {
+    putChar(uint8_t(i >> k));
+  }
+}
@@ -19,9 +19,17 @@ public:
     virtual void close() = 0;
     virtual auto getchar() -> int = 0;
     virtual void putChar(uint8_t c) = 0;
+    virtual auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t = 0;
+    virtual void blockWrite(uint8_t *ptr, uint64_t count) = 0;
+    /**
+     * Reads exactly @ref count bytes, quits when the file ends sooner.
+     */
+    void blockReadExact(uint8_t *ptr, uint64_t count);
     void append(const char *s);
     auto getVLI() -> uint64_t;
     void putVLI(uint64_t i);
+    auto get64() -> uint64_t;
+    void put64(uint64_t i);
     virtual void setpos(uint64_t newPos) = 0;
     virtual void setEnd() = 0;
     virtual auto curPos() -> uint64_t = 0;
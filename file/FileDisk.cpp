@@ -1,5 +1,81 @@
 #include "FileDisk.hpp"
 #include "../SystemDefines.hpp"
+#ifdef WINDOWS
+#include <fcntl.h> //_O_BINARY
+#include <io.h> //_dup(), _dup2(), _setmode()
+#endif
+#ifdef __linux__
+#include <fcntl.h> //posix_fadvise(), sync_file_range()
+#include <sys/mman.h> //madvise()
+#include <sys/stat.h> //fstat()
+#endif
+
+FILE *FileDisk::standardOutput = nullptr;
+bool FileDisk::dropCache = false;
+
+void FileDisk::setDropCache(bool enabled) { dropCache = enabled; }
+
+void FileDisk::startDropBehind(int fd, bool written) {
+#ifdef __linux__
+  struct stat status {};
+  if( !dropCache || fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) ) {
+    return;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  cacheFd = fd;
+  droppedPos = 0;
+  cacheWritten = written;
+#endif
+}
+
+void FileDisk::dropPages(uint64_t pos, uint8_t *mapping) {
+#ifdef __linux__
+  // the last (partial) window is kept: it may still be buffered or accessed
+  const uint64_t end = (pos & ~(DROP_WINDOW - 1)) - DROP_WINDOW;
+  const uint64_t length = end - droppedPos;
+  if( mapping != nullptr ) { // unmap the pages from our address space (dirty ones stay in the page cache)
+    madvise(&mapping[droppedPos], length, MADV_DONTNEED);
+  }
+  if( cacheWritten ) {
+    // dirty pages can't be dropped: start writing back the next window and wait for the older ones
+    sync_file_range(cacheFd, end, DROP_WINDOW, SYNC_FILE_RANGE_WRITE);
+    sync_file_range(cacheFd, droppedPos, length, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+  }
+  posix_fadvise(cacheFd, droppedPos, length, POSIX_FADV_DONTNEED);
+  droppedPos = end;
+#endif
+}
+
+void FileDisk::finishDropBehind() {
+#ifdef __linux__
+  if( cacheFd >= 0 ) {
+    if( cacheWritten ) { // the rest is written back by the system: it is dropped only when it is clean
+      sync_file_range(cacheFd, droppedPos, 0, SYNC_FILE_RANGE_WRITE);
+    }
+    posix_fadvise(cacheFd, droppedPos, 0, POSIX_FADV_DONTNEED);
+    cacheFd = -1;
+  }
+#endif
+}
+
+auto FileDisk::redirectStdout() -> bool {
+  fflush(stdout);
+#ifdef WINDOWS
+  const int fd = _dup(_fileno(stdout));
+  if( fd < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0 ) {
+    return false;
+  }
+  _setmode(fd, _O_BINARY);
+  standardOutput = _fdopen(fd, "wb");
+#else
+  const int fd = dup(fileno(stdout));
+  if( fd < 0 || dup2(fileno(stderr), fileno(stdout)) < 0 ) {
+    return false;
+  }
+  standardOutput = fdopen(fd, "wb");
+#endif
+  return standardOutput != nullptr;
+}
 
 FileDisk::FileDisk() { file = nullptr; }
 
@@ -7,8 +83,20 @@ FileDisk::~FileDisk() { close(); }
 
 auto FileDisk::open(const char *filename, bool mustSucceed) -> bool {
   assert(file == nullptr);
+  if( strcmp(filename, "-") == 0 ) {
+#ifdef WINDOWS
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    file = stdin;
+    return true;
+  }
   file = openFile(filename, READ);
   const bool success = (file != nullptr);
+#ifdef UNIX
+  if( success ) {
+    startDropBehind(fileno(file), false);
+  }
+#endif
   if( !success && mustSucceed ) {
     printf("Unable to open file %s (%s)", filename, strerror(errno));
     quit();
@@ -18,16 +106,29 @@ auto FileDisk::open(const char *filename, bool mustSucceed) -> bool {
 
 void FileDisk::create(const char *filename) {
   assert(file == nullptr);
+  if( strcmp(filename, "-") == 0 ) {
+    assert(standardOutput != nullptr);
+    file = standardOutput;
+    standardOutput = nullptr; // it is closed by close()
+    return;
+  }
   makeDirectories(filename);
   file = openFile(filename, WRITE);
   if( file == nullptr ) {
     printf("Unable to create file %s (%s)", filename, strerror(errno));
     quit();
   }
+#ifdef UNIX
+  startDropBehind(fileno(file), true);
+#endif
 }
 
 void FileDisk::close() {
   if( file != nullptr ) {
+    if( cacheFd >= 0 ) {
+      fflush(file);
+      finishDropBehind();
+    }
     fclose(file);
   }
   file = nullptr;
@@ -37,6 +138,23 @@ auto FileDisk::getchar() -> int { return fgetc(file); }
 
 void FileDisk::putChar(uint8_t c) { fputc(c, file); }
 
+auto FileDisk::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  const uint64_t n = fread(ptr, 1, count, file);
+  if( cacheFd >= 0 ) {
+    dropBehind(ftello(file), nullptr);
+  }
+  return n;
+}
+
+void FileDisk::blockWrite(uint8_t *ptr, uint64_t count) {
+  if( fwrite(ptr, 1, count, file) != count ) {
+    quit("Write error.");
+  }
+  if( cacheFd >= 0 ) {
+    dropBehind(ftello(file), nullptr);
+  }
+}
+
 void FileDisk::setpos(uint64_t newPos) { fseeko(file, newPos, SEEK_SET); }
 
 void FileDisk::setEnd() { fseeko(file, 0, SEEK_END); }
@@ -7,12 +7,62 @@
 /**
  * This class is responsible for files on disk.
  * It simply passes function calls to stdio.
+ * The file name "-" stands for stdin (open) and stdout (create): these can't be positioned.
  */
 class FileDisk : public File {
 protected:
     FILE *file;
+    static FILE *standardOutput; /**< the original stdout after redirectStdout() */
+    static bool dropCache; /**< see setDropCache() */
+    static constexpr uint64_t DROP_WINDOW = UINT64_C(8) << 20; /**< the content is dropped from the page cache in steps of this size */
+    int cacheFd {-1}; /**< the descriptor of a regular file whose pages are dropped behind the cursor, -1: they are not dropped */
+    uint64_t droppedPos {}; /**< the content before this position is dropped from the page cache */
+    bool cacheWritten {}; /**< the file is written: its pages must be written back before they can be dropped */
+
+    /**
+     * Declares sequential access to the file and starts dropping its pages behind the cursor (when enabled by setDropCache())
+     * @param fd the descriptor of the open file
+     * @param written true when the file is written
+     */
+    void startDropBehind(int fd, bool written);
+
+    /**
+     * Drops the pages of the content before @ref pos (except for the last window) from the page cache
+     * @param pos the position of the cursor
+     * @param mapping the memory mapping of the file, or nullptr
+     */
+    void dropBehind(const uint64_t pos, uint8_t *mapping) {
+      if( cacheFd >= 0 && pos >= droppedPos + 2 * DROP_WINDOW ) {
+        dropPages(pos, mapping);
+      }
+    }
+
+    /**
+     * Stops dropping the pages of the file before it is closed, and drops what is possible without waiting
+     */
+    void finishDropBehind();
+
+private:
+    void dropPages(uint64_t pos, uint8_t *mapping);
 
 public:
+    /**
+     * When enabled, the regular files opened or created afterwards are accessed as sequential streams:
+     * the system is told to read ahead, and the pages behind the cursor are dropped from the page cache
+     * (written ones after they are written back), so that huge files don't evict other cached data.
+     * Only the content accessed through blockRead() and blockWrite() is dropped. Linux only.
+     */
+    static void setDropCache(bool enabled);
+
+
+    /**
+     * Moves stdout to a new stream that is used when "-" is created (i.e. when the archive or the
+     * extracted content is written to stdout), and points stdout to stderr, so that the messages
+     * printed with printf() don't mix with the data.
+     * @return false on failure
+     */
+    static auto redirectStdout() -> bool;
+
     FileDisk();
     ~FileDisk() override;
     auto open(const char *filename, bool mustSucceed) -> bool override;
@@ -20,6 +70,8 @@ public:
     void close() override;
     auto getchar() -> int override;
     void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
     void setpos(uint64_t newPos) override;
     void setEnd() override;
     auto curPos() -> uint64_t override;
@@ -0,0 +1,175 @@
+#include "FileMapped.hpp"
+#include "../SystemDefines.hpp"
+#ifdef UNIX
+#include <fcntl.h> //open(), posix_fallocate()
+#include <sys/mman.h> //mmap()
+#endif
+
+FileMapped::~FileMapped() { close(); }
+
+auto FileMapped::open(const char *filename, bool mustSucceed) -> bool {
+  assert(file == nullptr && data == nullptr);
+#ifdef UNIX
+  if( strcmp(filename, "-") != 0 ) {
+    fd = ::open(filename, O_RDONLY);
+    struct stat status {};
+    if( fd >= 0 && fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0 ) {
+      void *p = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if( p != MAP_FAILED ) {
+        data = static_cast<uint8_t *>(p);
+        capacity = fileSize = status.st_size;
+        filePos = 0;
+        writable = false;
+        eofReached = false;
+        startDropBehind(fd, false);
+#ifdef __linux__
+        if( cacheFd >= 0 ) {
+          madvise(data, capacity, MADV_SEQUENTIAL);
+        }
+#endif
+        return true;
+      }
+    }
+    if( fd >= 0 ) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+#endif
+  return FileDisk::open(filename, mustSucceed);
+}
+
+void FileMapped::create(const char *filename) {
+  FileDisk::create(filename);
+}
+
+void FileMapped::create(const char *filename, uint64_t size) {
+  assert(file == nullptr && data == nullptr);
+#if defined(UNIX) && defined(__linux__)
+  if( strcmp(filename, "-") != 0 && size > 0 ) {
+    makeDirectories(filename);
+    fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if( fd < 0 ) {
+      printf("Unable to create file %s (%s)", filename, strerror(errno));
+      quit();
+    }
+    // the space must be allocated: writing to a mapping on a full disk would crash (SIGBUS) instead of failing
+    if( posix_fallocate(fd, 0, size) == 0 ) {
+      void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if( p != MAP_FAILED ) {
+        data = static_cast<uint8_t *>(p);
+        capacity = size;
+        fileSize = 0;
+        filePos = 0;
+        writable = true;
+        eofReached = false;
+        startDropBehind(fd, true);
+        return;
+      }
+    }
+    ::close(fd);
+    fd = -1;
+  }
+#endif
+  FileDisk::create(filename);
+}
+
+void FileMapped::close() {
+#ifdef UNIX
+  if( data != nullptr ) {
+    munmap(data, capacity);
+    if( writable && fileSize < capacity && ftruncate(fd, fileSize) != 0 ) { // less was written than allocated
+      printf("Unable to truncate the output file (%s)\n", strerror(errno));
+    }
+    finishDropBehind();
+    ::close(fd);
+    fd = -1;
+    data = nullptr;
+    return;
+  }
+#endif
+  FileDisk::close();
+}
+
+auto FileMapped::getchar() -> int {
+  if( data == nullptr ) {
+    return FileDisk::getchar();
+  }
+  if( filePos >= fileSize ) {
+    eofReached = true;
+    return EOF;
+  }
+  return data[filePos++];
+}
+
+void FileMapped::putChar(uint8_t c) {
+  if( data == nullptr ) {
+    FileDisk::putChar(c);
+    return;
+  }
+  blockWrite(&c, 1);
+}
+
+auto FileMapped::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  if( data == nullptr ) {
+    return FileDisk::blockRead(ptr, count);
+  }
+  const uint64_t n = filePos < fileSize ? std::min<uint64_t>(count, fileSize - filePos) : 0;
+  memcpy(ptr, &data[filePos], n);
+  filePos += n;
+  dropBehind(filePos, data);
+  if( n < count ) {
+    eofReached = true;
+  }
+  return n;
+}
+
+void FileMapped::blockWrite(uint8_t *ptr, uint64_t count) {
+  if( data == nullptr ) {
+    FileDisk::blockWrite(ptr, count);
+    return;
+  }
+  if( !writable || count > capacity - filePos ) {
+    quit("Write error.");
+  }
+  memcpy(&data[filePos], ptr, count);
+  filePos += count;
+  dropBehind(filePos, data);
+  if( filePos > fileSize ) {
+    fileSize = filePos;
+  }
+}
+
+void FileMapped::setpos(uint64_t newPos) {
+  if( data == nullptr ) {
+    FileDisk::setpos(newPos);
+    return;
+  }
+  filePos = std::min<uint64_t>(newPos, writable ? capacity : fileSize);
+  eofReached = false;
+}
+
+void FileMapped::setEnd() {
+  if( data == nullptr ) {
+    FileDisk::setEnd();
+    return;
+  }
+  filePos = fileSize;
+  eofReached = false;
+}
+
+auto FileMapped::curPos() -> uint64_t {
+  if( data == nullptr ) {
+    return FileDisk::curPos();
+  }
+  return filePos;
+}
+
+auto FileMapped::eof() -> bool {
+  if( data == nullptr ) {
+    return FileDisk::eof();
+  }
+  return eofReached;
+}
+
+auto FileMapped::isMapped() const -> bool { return data != nullptr; }
@@ -0,0 +1,52 @@
+#ifndef PAQ8PX_FILEMAPPED_HPP
+#define PAQ8PX_FILEMAPPED_HPP
+
+#include "FileDisk.hpp"
+
+/**
+ * This class is responsible for files on disk that are accessed through a memory mapping,
+ * so that their content is not copied through stdio buffers.
+ * Files that can't be mapped (pipes, non-regular or empty files, output of unknown size,
+ * or a system without mmap) are accessed through @ref FileDisk.
+ */
+class FileMapped : public FileDisk {
+private:
+    uint8_t *data {}; /**< the mapping, nullptr when the file is accessed through stdio */
+    uint64_t capacity {}; /**< size of the mapping */
+    uint64_t fileSize {}; /**< size of the content (output: the furthest position written) */
+    uint64_t filePos {};
+    bool writable {};
+    bool eofReached {};
+#ifdef UNIX
+    int fd {-1};
+#endif
+
+public:
+    FileMapped() = default;
+    ~FileMapped() override;
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+    void create(const char *filename) override;
+
+    /**
+     * Creates a file of (at most) @ref size bytes with its space allocated in advance, and maps it.
+     * @param filename
+     * @param size the size of the content to be written
+     */
+    void create(const char *filename, uint64_t size);
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+
+    /**
+     * @return true when the file is memory mapped
+     */
+    [[nodiscard]] auto isMapped() const -> bool;
+};
+
+#endif //PAQ8PX_FILEMAPPED_HPP
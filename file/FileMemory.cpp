@@ -0,0 +1,78 @@
+#include "FileMemory.hpp"
+
+FileMemory::FileMemory() : content(0) {}
+
+FileMemory::~FileMemory() { close(); }
+
+auto FileMemory::open(const char * /*filename*/, bool /*mustSucceed*/) -> bool {
+  assert(false); // in-memory files have no name
+  return false;
+}
+
+void FileMemory::create(const char * /*filename*/) {
+  assert(false); // in-memory files have no name
+}
+
+void FileMemory::close() {
+  content.resize(0);
+  filePos = 0;
+  fileSize = 0;
+}
+
+void FileMemory::reserve(uint64_t newSize) {
+  if( newSize > content.size() ) {
+    content.resize(std::max<uint64_t>(newSize, content.size() * 2 + 4096));
+  }
+}
+
+auto FileMemory::getchar() -> int {
+  if( filePos >= fileSize ) {
+    return EOF;
+  }
+  return content[filePos++];
+}
+
+void FileMemory::putChar(uint8_t c) {
+  reserve(filePos + 1);
+  content[filePos++] = c;
+  if( filePos > fileSize ) {
+    fileSize = filePos;
+  }
+}
+
+auto FileMemory::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  if( filePos >= fileSize ) {
+    return 0;
+  }
+  if( count > fileSize - filePos ) {
+    count = fileSize - filePos;
+  }
+  memcpy(ptr, &content[filePos], count);
+  filePos += count;
+  return count;
+}
+
+void FileMemory::blockWrite(uint8_t *ptr, uint64_t count) {
+  if( count == 0 ) {
+    return;
+  }
+  reserve(filePos + count);
+  memcpy(&content[filePos], ptr, count);
+  filePos += count;
+  if( filePos > fileSize ) {
+    fileSize = filePos;
+  }
+}
+
+void FileMemory::setpos(uint64_t newPos) {
+  assert(newPos <= fileSize);
+  filePos = newPos;
+}
+
+void FileMemory::setEnd() { filePos = fileSize; }
+
+auto FileMemory::curPos() -> uint64_t { return filePos; }
+
+auto FileMemory::eof() -> bool { return filePos >= fileSize; }
+
+auto FileMemory::size() const -> uint64_t { return fileSize; }
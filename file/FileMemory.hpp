@@ -0,0 +1,37 @@
+#ifndef PAQ8PX_FILEMEMORY_HPP
+#define PAQ8PX_FILEMEMORY_HPP
+
+#include "File.hpp"
+#include "../Array.hpp"
+
+/**
+ * This class is responsible for files kept entirely in memory.
+ * It is used for assembling (and parsing) independently coded blocks before
+ * they are written to (after they are read from) the archive.
+ * Reading past the end returns EOF like a file on disk would.
+ */
+class FileMemory : public File {
+private:
+    Array<uint8_t> content; /**< The content (its size is the capacity, which grows exponentially) */
+    uint64_t filePos {};
+    uint64_t fileSize {};
+    void reserve(uint64_t newSize);
+
+public:
+    FileMemory();
+    ~FileMemory() override;
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+    void create(const char *filename) override;
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+    [[nodiscard]] auto size() const -> uint64_t;
+};
+
+#endif //PAQ8PX_FILEMEMORY_HPP
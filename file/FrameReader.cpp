@@ -0,0 +1,71 @@
+#include "FrameReader.hpp"
+
+FrameReader::FrameReader(File *archive) : archive(archive) {}
+
+auto FrameReader::open(const char * /*filename*/, bool /*mustSucceed*/) -> bool {
+  assert(false); // the frames are read from an already open archive
+  return false;
+}
+
+void FrameReader::create(const char * /*filename*/) {
+  assert(false); // read only
+}
+
+void FrameReader::close() {}
+
+void FrameReader::nextFrame() {
+  const uint64_t rawSize = archive->getVLI();
+  frameLeft = archive->getVLI();
+  if( archive->eof() ) {
+    quit("Unexpected end of archive.");
+  }
+  ended = rawSize == 0;
+  contentSize += rawSize;
+}
+
+auto FrameReader::getchar() -> int {
+  while( frameLeft == 0 ) {
+    if( ended ) {
+      return EOF;
+    }
+    nextFrame();
+  }
+  frameLeft--;
+  position++;
+  return archive->getchar();
+}
+
+void FrameReader::putChar(uint8_t /*c*/) {
+  assert(false); // read only
+}
+
+auto FrameReader::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  for( uint64_t i = 0; i < count; i++ ) {
+    const int c = getchar();
+    if( c == EOF ) {
+      return i;
+    }
+    ptr[i] = static_cast<uint8_t>(c);
+  }
+  return count;
+}
+
+void FrameReader::blockWrite(uint8_t * /*ptr*/, uint64_t /*count*/) {
+  assert(false); // read only
+}
+
+void FrameReader::setpos(uint64_t /*newPos*/) {
+  assert(false); // sequential only
+}
+
+void FrameReader::setEnd() {
+  assert(false); // sequential only
+}
+
+auto FrameReader::curPos() -> uint64_t { return position; }
+
+auto FrameReader::eof() -> bool { return ended && frameLeft == 0; }
+
+auto FrameReader::getContentSize() const -> uint64_t { return contentSize; }
+
+auto FrameReader::isLastFrame() const -> bool { return ended; }
@@ -0,0 +1,43 @@
+#ifndef PAQ8PX_FRAMEREADER_HPP
+#define PAQ8PX_FRAMEREADER_HPP
+
+#include "File.hpp"
+
+/**
+ * This class reads the payload of a streamed archive (see compressStream()) as one continuous
+ * sequence of bytes, so that the arithmetic decoder can read ahead across frame boundaries.
+ * The frame headers are consumed on the way: they tell how much content is available so far.
+ * After the last frame it returns EOF like a file on disk would.
+ * It can only be read sequentially.
+ */
+class FrameReader : public File {
+private:
+    File *archive;
+    uint64_t frameLeft {}; /**< payload bytes left in the current frame */
+    uint64_t contentSize {}; /**< total uncompressed size of the frames opened so far */
+    uint64_t position {}; /**< payload bytes read so far */
+    bool ended {}; /**< the last frame is opened */
+    void nextFrame();
+
+public:
+    explicit FrameReader(File *archive);
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+    void create(const char *filename) override;
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+
+    /**
+     * Returns the uncompressed size of the frames read so far. It is final when isLastFrame() is true.
+     */
+    [[nodiscard]] auto getContentSize() const -> uint64_t;
+    [[nodiscard]] auto isLastFrame() const -> bool;
+};
+
+#endif //PAQ8PX_FRAMEREADER_HPP
@@ -3,26 +3,172 @@
 
 #include "../Array.hpp"
 #include "../Encoder.hpp"
+#include "../file/AsyncReader.hpp"
+#include "../file/AsyncWriter.hpp"
+#include "../file/BufferedReader.hpp"
+#include "../file/BufferedWriter.hpp"
 #include "../file/File.hpp"
 #include "../file/FileDisk.hpp"
+#include "../file/FileMapped.hpp"
+#include "../file/FileMemory.hpp"
+#include "../file/FrameReader.hpp"
 #include "../Utils.hpp"
 #include <cctype>
 #include <cstdint>
 #include <cstring>
+#include <thread>
 
 
 
-//////////////////// Compress, Decompress ////////////////////////////
-
 typedef enum {
   FDECOMPRESS, FCOMPARE
 } FMode;
 
-static void compressfile(const Shared* const shared, const char *filename, uint64_t fileSize, Encoder &en, bool verbose) {
+//////////////////// Model snapshots ////////////////////////////
+//
+// A solid archive may be accompanied by a side file holding snapshots of the complete
+// model and coder state (see Encoder::saveState()), taken at every "interval" bytes of
+// the content. A range is then extracted by restoring the last snapshot before it and
+// decoding from there instead of from the beginning of the content.
+// Each snapshot is about as large as the memory used by the selected level.
+// Layout:
+//   PROGNAME, SNAPSHOT_VERSION, level (as in the archive header), VLI(content size), VLI(interval)
+//   snapshots: 64-bit position in the content, state
+//   64-bit file position of each snapshot, 64-bit file position of this index
+//   64-bit size and 64-bit fingerprint of the archive (see archiveFingerprint())
+// The snapshots are used only when the archive has the same size and fingerprint: a side file left over
+// from an earlier archive of the same name is ignored.
+
+#define SNAPSHOT_EXTENSION ".snapshots"
+
+/**
+ * The layout of the model state in a snapshot: to be incremented when the state of a model or archiveFingerprint() changes.
+ * The high bit keeps it apart from the level byte that followed PROGNAME in the snapshot files without a version.
+ */
+static constexpr uint8_t SNAPSHOT_VERSION = 0x82;
+
+/**
+ * @return a hash of the size of the archive file @ref archiveName and of FINGERPRINT_SAMPLES samples of its content
+ * (the whole content of a small archive), and its size in @ref size (0 when it can't be read).
+ * The samples are evenly spaced from the header to the end of the coded content, so the cost does not grow with
+ * the archive: a -range extraction reads only the part of the archive it decodes.
+ */
+static auto archiveFingerprint(const char *archiveName, uint64_t &size) -> uint64_t {
+  static constexpr uint64_t FINGERPRINT_SAMPLES = 16;
+  static constexpr uint64_t SAMPLE_SIZE = 4096;
+  size = 0;
+  FileDisk archive;
+  if( !archive.open(archiveName, false) ) {
+    return 0;
+  }
+  archive.setEnd();
+  size = archive.curPos();
+  uint64_t fingerprint = 0;
+  uint8_t buffer[SAMPLE_SIZE];
+  const uint64_t samples = size <= FINGERPRINT_SAMPLES * SAMPLE_SIZE ? (size + SAMPLE_SIZE - 1) / SAMPLE_SIZE : FINGERPRINT_SAMPLES;
+  for( uint64_t s = 0; s < samples; s++ ) {
+    const uint64_t position = samples == 1 ? 0 : (size - std::min(size, SAMPLE_SIZE)) * s / (samples - 1);
+    archive.setpos(position);
+    const uint64_t n = archive.blockRead(buffer, SAMPLE_SIZE);
+    for( uint64_t i = 0; i < n; i += 8 ) {
+      uint64_t word = 0;
+      memcpy(&word, &buffer[i], std::min<uint64_t>(8, n - i));
+      fingerprint = combine64(fingerprint, word);
+    }
+  }
+  archive.close();
+  return combine64(fingerprint, size);
+}
+
+/**
+ * Appends the size and the fingerprint of the finished archive @ref archiveName to @ref snapshots (see compressfile())
+ */
+static void finishSnapshots(File *snapshots, const char *archiveName) {
+  uint64_t archiveSize;
+  const uint64_t fingerprint = archiveFingerprint(archiveName, archiveSize);
+  snapshots->put64(archiveSize);
+  snapshots->put64(fingerprint);
+}
+
+/**
+ * Restores @ref en from the last snapshot taken at or before @ref offset.
+ * @return the position in the content where decoding continues (0: no usable snapshot)
+ */
+template<SIMDType simd>
+static auto loadSnapshot(const Shared *const shared, File *snapshots, const char *archiveName, uint64_t fileSize, uint64_t offset,
+                         Encoder<simd> &en) -> uint64_t {
+  const int len = static_cast<int>(strlen(PROGNAME));
+  for( int i = 0; i < len; i++ ) {
+    if( snapshots->getchar() != PROGNAME[i] ) {
+      printf("Not a valid snapshot file, ignored.\n");
+      return 0;
+    }
+  }
+  if( snapshots->getchar() != SNAPSHOT_VERSION ) {
+    printf("The snapshots were written by another version, ignored.\n");
+    return 0;
+  }
+  const bool memOption = (shared->levelByte() & OPTION_MEMORY) != 0;
+  if( snapshots->getchar() != shared->levelByte() || (memOption && snapshots->getchar() != shared->memBits()) ||
+      snapshots->getVLI() != fileSize ) {
+    printf("The snapshots do not belong to this archive, ignored.\n");
+    return 0;
+  }
+  const uint64_t interval = snapshots->getVLI();
+  if( interval == 0 || offset < interval ) {
+    return 0;
+  }
+  const uint64_t headerSize = snapshots->curPos();
+  snapshots->setEnd();
+  const uint64_t snapshotsSize = snapshots->curPos();
+  if( snapshotsSize < headerSize + 24 ) {
+    printf("The snapshots are incomplete, ignored.\n");
+    return 0;
+  }
+  snapshots->setpos(snapshotsSize - 24);
+  const uint64_t indexPosition = snapshots->get64();
+  const uint64_t archiveSize = snapshots->get64();
+  const uint64_t fingerprint = snapshots->get64();
+  uint64_t actualSize;
+  if( archiveFingerprint(archiveName, actualSize) != fingerprint || actualSize != archiveSize ) {
+    printf("The snapshots do not belong to this archive, ignored.\n");
+    return 0;
+  }
+  if( indexPosition < headerSize || indexPosition > snapshotsSize - 24 ) {
+    quit("Corrupted snapshot index.");
+  }
+  const uint64_t k = std::min<uint64_t>(offset / interval, (snapshotsSize - 24 - indexPosition) / 8);
+  if( k == 0 ) {
+    return 0;
+  }
+  snapshots->setpos(indexPosition + 8 * (k - 1));
+  snapshots->setpos(snapshots->get64());
+  const uint64_t pos = snapshots->get64();
+  if( pos != k * interval ) {
+    quit("Corrupted snapshot index.");
+  }
+  en.loadState(snapshots);
+  return pos;
+}
+
+//////////////////// Compress, Decompress ////////////////////////////
+
+// Compress a file
+// When @ref snapshots is not nullptr a model snapshot is written to it at every @ref snapshotInterval bytes,
+// then finishSnapshots() must be called when the archive is complete
+template<SIMDType simd>
+static void compressfile(const Shared* const shared, const char *filename, uint64_t fileSize, Encoder<simd> &en, bool verbose,
+                         File *snapshots = nullptr, uint64_t snapshotInterval = 0) {
 
   uint64_t start = en.size();
-  FileDisk in;
+  FileMapped in;
   in.open(filename, true);
+  AsyncReader asyncIn(&in);
+  if( shared->asyncIo ) {
+    asyncIn.start();
+  }
+  File *input = shared->asyncIo ? static_cast<File *>(&asyncIn) : &in;
+  Array<uint8_t> block(65536);
 
   float p1 = 0.0f;
   float p2 = 1.0f;
@@ -30,21 +176,70 @@ static void compressfile(const Shared* const shared, const char *filename, uint6
   p2 = p1 + pscale * fileSize;
   en.setStatusRange(p1, p2);
 
+  Array<uint64_t> snapshotPositions(0);
+  if( snapshots != nullptr ) {
+    snapshots->append(PROGNAME);
+    snapshots->putChar(SNAPSHOT_VERSION);
+    shared->writeLevel(snapshots);
+    snapshots->putVLI(fileSize);
+    snapshots->putVLI(snapshotInterval);
+  }
+
   fprintf(stderr, "Compressing... ");
-  for (uint64_t j = 0; j < fileSize; ++j) {
-    if ((j & 0xfffff) == 0) {
+  for( uint64_t j = 0; j < fileSize; ) {
+    if( snapshots != nullptr && j != 0 && j % snapshotInterval == 0 ) {
+      snapshotPositions.pushBack(snapshots->curPos());
+      snapshots->put64(j);
+      en.saveState(snapshots);
+    }
+    // the blocks end at the snapshot positions and at every 1 MB for the status
+    uint64_t n = std::min<uint64_t>(block.size() - (j & (block.size() - 1)), fileSize - j);
+    if( snapshots != nullptr ) {
+      n = std::min<uint64_t>(n, snapshotInterval - j % snapshotInterval);
+    }
+    if( input->blockRead(&block[0], n) != n ) {
+      quit("Unexpected end of file.");
+    }
+    if( (j & 0xfffff) == 0 ) {
       en.printStatus(j, fileSize);
     }
-    en.compressByte(&en.predictorMain, in.getchar());
+    en.compressBytes(&en.predictorMain, &block[0], n);
+    j += n;
   }
   fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
 
+  if( snapshots != nullptr ) { // snapshot index
+    const uint64_t indexPosition = snapshots->curPos();
+    for( uint64_t i = 0; i < snapshotPositions.size(); i++ ) {
+      snapshots->put64(snapshotPositions[i]);
+    }
+    snapshots->put64(indexPosition);
+  }
+
   p1 = p2;
 
+  asyncIn.close();
   in.close();
 }
 
-static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMode mode) -> uint64_t {
+/**
+ * Starts reading (compare) or writing (decompress) @ref f on a separate thread when requested
+ * @return the file to be used by the decoding loop
+ */
+static auto startAsyncIo(const Shared *const shared, FMode fMode, File *f, AsyncReader *reader, AsyncWriter *writer) -> File * {
+  if( !shared->asyncIo ) {
+    return f;
+  }
+  if( fMode == FCOMPARE ) {
+    reader->start();
+    return reader;
+  }
+  writer->start();
+  return writer;
+}
+
+template<SIMDType simd>
+static auto decompressRecursive(BufferedWriter *out, BufferedReader *original, uint64_t blockSize, Encoder<simd> &en, FMode mode) -> uint64_t {
   for( uint64_t j = 0; j < blockSize; ++j ) {
     if((j & 0xfffff) == 0u ) {
       en.printStatus();
@@ -52,7 +247,7 @@ static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMod
     if( mode == FDECOMPRESS ) {
       out->putChar(en.decompressByte(&en.predictorMain));
     } else { //compare
-      if( en.decompressByte(&en.predictorMain) != out->getchar()) {
+      if( en.decompressByte(&en.predictorMain) != original->getchar()) {
         return j+1;
       }
     }
@@ -61,21 +256,41 @@ static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMod
 }
 
 // Decompress or compare a file
-static void decompressFile(const Shared *const shared, const char *filename, FMode fMode, Encoder &en, uint64_t fileSize) {
+// Only the range [offset, offset+length) is extracted: the content before it must be decoded (and is discarded)
+// unless decoding can be resumed from a model snapshot (when @ref snapshots is not nullptr, the side file of @ref archiveName)
+template<SIMDType simd>
+static void decompressFile(const Shared *const shared, const char *filename, FMode fMode, Encoder<simd> &en, uint64_t offset, uint64_t length,
+                           uint64_t fileSize = 0, File *snapshots = nullptr, const char *archiveName = nullptr) {
+  const uint64_t start = snapshots != nullptr ? loadSnapshot(shared, snapshots, archiveName, fileSize, offset, en) : 0;
 
-  FileDisk f;
+
+  FileMapped f;
   if( fMode == FCOMPARE ) {
     f.open(filename, true);
     printf("Comparing");
   } else { //mode==FDECOMPRESS;
-    f.create(filename);
+    f.create(filename, length);
     printf("Extracting");
   }
-  printf(" %s %" PRIu64 " bytes -> ", filename, fileSize);
+  printf(" %s %" PRIu64 " bytes -> ", filename, length);
+
+  for( uint64_t j = start; j < offset; ++j ) {
+    if((j & 0xfffff) == 0u ) {
+      en.printStatus();
+    }
+    en.decompressByte(&en.predictorMain);
+  }
 
   // Decompress/Compare
-  uint64_t r = decompressRecursive(&f, fileSize, en, fMode);
-  if( fMode == FCOMPARE && (r == 0u) && f.getchar() != EOF) {
+  AsyncReader asyncOriginal(&f);
+  AsyncWriter asyncOut(&f);
+  File *io = startAsyncIo(shared, fMode, &f, &asyncOriginal, &asyncOut);
+  BufferedWriter out(io);
+  BufferedReader original(io);
+  uint64_t r = decompressRecursive(&out, &original, length, en, fMode);
+  out.flush();
+  asyncOut.close();
+  if( fMode == FCOMPARE && (r == 0u) && original.getchar() != EOF) {
     printf("file is longer\n");
   } else if( fMode == FCOMPARE && (r != 0u)) {
     printf("differ at %" PRIu64 "\n", r - 1);
@@ -84,6 +299,379 @@ static void decompressFile(const Shared *const shared, const char *filename, FMo
   } else {
     printf("done   \n");
   }
+  asyncOriginal.close();
+  f.close();
+}
+
+//////////////////// Block-parallel compression ////////////////////////////
+//
+// In block mode the input is split into blocks of a fixed size. Each block is coded
+// independently (with a fresh Predictor and ArithmeticEncoder) on a worker thread.
+// After the archive header (level|OPTION_BLOCKS, file size, block size) each block
+// is stored as a frame:
+//   VLI(uncompressed size) VLI(compressed size) compressed bytes
+// Frames are written in block order, so the archive content does not depend on the
+// number of threads. Each worker uses the memory of the selected level (or -auto, -mem: Shared::mem).
+// The frames are followed by the block index that makes the archive seekable:
+//   64-bit archive position of each frame, 64-bit archive position of the index
+// A byte range is extracted by decoding only the blocks that cover it.
+
+struct BlockJob {
+  std::thread thread;
+  Array<uint8_t> raw{0}; /**< uncompressed content of the block */
+  FileMemory packed; /**< compressed content of the block */
+  uint64_t rawSize {};
+  bool failed {}; /**< the worker gave up (e.g. out of memory), the message is already printed */
+};
+
+/**
+ * The worker slots of the blocks in flight (block b is in slot b % threads).
+ * The destructor joins the workers that are still running: when the main thread quits (e.g. on a corrupted archive),
+ * they don't outlive the jobs and the settings they use.
+ */
+class BlockJobs {
+private:
+    BlockJob *const jobs;
+    const uint32_t threads;
+
+public:
+    explicit BlockJobs(const uint32_t threads) : jobs(new BlockJob[threads]), threads(threads) {}
+    BlockJobs(const BlockJobs &) = delete;
+    auto operator=(const BlockJobs &) -> BlockJobs & = delete;
+
+    ~BlockJobs() {
+      for( uint32_t i = 0; i < threads; i++ ) {
+        if( jobs[i].thread.joinable() ) {
+          jobs[i].thread.join();
+        }
+      }
+      delete[] jobs;
+    }
+
+    /**
+     * @return the slot of block @ref b
+     */
+    auto operator[](const uint64_t b) -> BlockJob & { return jobs[b % threads]; }
+};
+
+static void copyBytes(File *in, File *out, uint64_t count) {
+  uint8_t buffer[65536];
+  while( count > 0 ) {
+    const uint64_t n = in->blockRead(buffer, std::min<uint64_t>(count, sizeof(buffer)));
+    if( n == 0 ) {
+      quit("Unexpected end of file.");
+    }
+    out->blockWrite(buffer, n);
+    count -= n;
+  }
+}
+
+/**
+ * Sets up the model of worker slot @ref worker with the settings of @ref parent.
+ * With -numa local the worker runs on the CPUs of node worker % nodes and its large tables are bound there.
+ */
+static void initWorker(Shared &shared, const Shared *const parent, const uint32_t worker) {
+  shared.init(parent->level);
+  shared.setMem(parent->mem);
+  shared.prefaultThreads = parent->prefaultThreads;
+  shared.numaPolicy = parent->numaPolicy;
+  shared.numaNode = worker % numaNodeCount();
+  if( shared.numaPolicy == NumaPolicy::Local && numaNodeCount() > 1 ) {
+    numaPinThread(shared.numaNode);
+  }
+  shared.chosenSimd = parent->chosenSimd;
+}
+
+template<SIMDType simd>
+static void compressBlock(BlockJob *job, const Shared *const parent, const uint32_t worker) {
+  try {
+    Shared shared;
+    initWorker(shared, parent, worker);
+    Encoder<simd> en(&shared, COMPRESS, &job->packed);
+    en.compressBytes(&en.predictorMain, &job->raw[0], job->rawSize);
+    en.flush();
+  }
+  catch( IntentionalException const & ) {
+    job->failed = true;
+  }
+}
+
+template<SIMDType simd>
+static void decompressBlock(BlockJob *job, const Shared *const parent, const uint32_t worker) {
+  try {
+    Shared shared;
+    initWorker(shared, parent, worker);
+    job->packed.setpos(0);
+    Encoder<simd> en(&shared, DECOMPRESS, &job->packed);
+    for( uint64_t i = 0; i < job->rawSize; i++ ) {
+      job->raw[i] = en.decompressByte(&en.predictorMain);
+    }
+  }
+  catch( IntentionalException const & ) {
+    job->failed = true;
+  }
+}
+
+template<SIMDType simd>
+static void compressFileBlocks(const Shared *const shared, const char *filename, uint64_t fileSize, File *archive, uint64_t blockSize, uint32_t threads) {
+  FileMapped in;
+  in.open(filename, true);
+
+  const uint64_t blockCount = (fileSize + blockSize - 1) / blockSize;
+  BlockJobs jobs(threads);
+
+  Array<uint64_t> framePositions(blockCount);
+
+  fprintf(stderr, "Compressing... ");
+  uint64_t nextBlock = 0; // next block to hand over to a worker
+  for( uint64_t b = 0; b < blockCount; b++ ) {
+    // keep up to "threads" blocks in flight, they are written to the archive in order
+    while( nextBlock < blockCount && nextBlock < b + threads ) {
+      BlockJob *job = &jobs[nextBlock];
+      job->rawSize = std::min<uint64_t>(blockSize, fileSize - nextBlock * blockSize);
+      job->raw.resize(job->rawSize);
+      if( in.blockRead(&job->raw[0], job->rawSize) != job->rawSize ) {
+        quit("Unexpected end of input file.");
+      }
+      job->packed.close();
+      job->thread = std::thread(compressBlock<simd>, job, shared, static_cast<uint32_t>(nextBlock % threads));
+      nextBlock++;
+    }
+    BlockJob *job = &jobs[b];
+    job->thread.join();
+    if( job->failed ) {
+      quit();
+    }
+    framePositions[b] = archive->curPos();
+    archive->putVLI(job->rawSize);
+    archive->putVLI(job->packed.size());
+    job->packed.setpos(0);
+    copyBytes(&job->packed, archive, job->packed.size());
+    fprintf(stderr, "%6.2f%%\b\b\b\b\b\b\b", (b + 1) * 100.0f / blockCount);
+    fflush(stderr);
+  }
+  fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
+
+  // block index
+  const uint64_t indexPosition = archive->curPos();
+  for( uint64_t b = 0; b < blockCount; b++ ) {
+    archive->put64(framePositions[b]);
+  }
+  archive->put64(indexPosition);
+
+  in.close();
+}
+
+/**
+ * Positions the archive to the frame of block @ref b using the block index.
+ */
+static void seekToBlock(File *archive, uint64_t b) {
+  archive->setEnd();
+  const uint64_t archiveSize = archive->curPos();
+  if( archiveSize < 8 ) {
+    quit("Block index is missing from archive.");
+  }
+  archive->setpos(archiveSize - 8);
+  const uint64_t indexPosition = archive->get64();
+  if( indexPosition + 8 * (b + 1) > archiveSize - 8 ) {
+    quit("Corrupted block index in archive.");
+  }
+  archive->setpos(indexPosition + 8 * b);
+  archive->setpos(archive->get64());
+}
+
+// Decompress or compare a file stored as independent blocks
+// Only the range [offset, offset+length) is extracted, the blocks outside of it are skipped
+template<SIMDType simd>
+static void decompressFileBlocks(const Shared *const shared, const char *filename, FMode fMode, File *archive, uint64_t fileSize,
+                                 uint64_t blockSize, uint32_t threads, uint64_t offset, uint64_t length) {
+
+  FileMapped f;
+  if( fMode == FCOMPARE ) {
+    f.open(filename, true);
+    printf("Comparing");
+  } else { //mode==FDECOMPRESS;
+    f.create(filename, length);
+    printf("Extracting");
+  }
+  printf(" %s %" PRIu64 " bytes -> ", filename, length);
+
+  const uint64_t endPos = offset + length;
+  const uint64_t firstBlock = offset / blockSize;
+  if( firstBlock != 0 ) {
+    seekToBlock(archive, firstBlock);
+  }
+  BlockJobs jobs(threads);
+  uint64_t nextPos = firstBlock * blockSize; // uncompressed position of the next block to hand over to a worker
+  uint64_t nextBlock = firstBlock;
+  uint64_t pos = nextPos; // uncompressed position of the next block to be written or compared
+  uint64_t diffPos = 0; // 1-based position of the first mismatch
+  Array<uint8_t> original(0);
+  for( uint64_t b = firstBlock; pos < endPos; b++ ) {
+    while( nextPos < endPos && nextBlock < b + threads ) {
+      BlockJob *job = &jobs[nextBlock];
+      job->rawSize = archive->getVLI();
+      const uint64_t packedSize = archive->getVLI();
+      if( job->rawSize == 0 || job->rawSize > fileSize - nextPos ) {
+        quit("Corrupted block header in archive.");
+      }
+      job->raw.resize(job->rawSize);
+      job->packed.close();
+      copyBytes(archive, &job->packed, packedSize);
+      job->thread = std::thread(decompressBlock<simd>, job, shared, static_cast<uint32_t>(nextBlock % threads));
+      nextPos += job->rawSize;
+      nextBlock++;
+    }
+    BlockJob *job = &jobs[b];
+    job->thread.join();
+    if( job->failed ) {
+      quit();
+    }
+    if( fMode == FDECOMPRESS ) {
+      const uint64_t from = pos < offset ? offset - pos : 0;
+      const uint64_t to = std::min<uint64_t>(job->rawSize, endPos - pos);
+      f.blockWrite(&job->raw[from], to - from);
+    } else if( diffPos == 0 ) { //compare
+      original.resize(job->rawSize);
+      const uint64_t n = f.blockRead(&original[0], job->rawSize);
+      for( uint64_t i = 0; i < job->rawSize; i++ ) {
+        if( i >= n || original[i] != job->raw[i] ) {
+          diffPos = pos + i + 1;
+          break;
+        }
+      }
+    }
+    pos += job->rawSize;
+    fprintf(stderr, "%6.2f%%\b\b\b\b\b\b\b", std::min<uint64_t>(pos, endPos) * 100.0f / (endPos + 1));
+    fflush(stderr);
+  }
+
+  if( fMode == FCOMPARE && diffPos == 0 && f.getchar() != EOF) {
+    printf("file is longer\n");
+  } else if( fMode == FCOMPARE && diffPos != 0 ) {
+    printf("differ at %" PRIu64 "\n", diffPos - 1);
+  } else if( fMode == FCOMPARE ) {
+    printf("identical\n");
+  } else {
+    printf("done   \n");
+  }
+  f.close();
+}
+
+//////////////////// Streaming ////////////////////////////
+//
+// When the input or the output is a pipe ("-"), the content size is not known in advance and the
+// archive can't be positioned. The content is then coded as a single solid stream, but the output
+// of the arithmetic coder is written in frames after every STREAM_FRAME_SIZE bytes of input:
+//   VLI(uncompressed size) VLI(compressed size) compressed bytes
+// The last frame has an uncompressed size of 0: it holds the final bytes of the arithmetic coder
+// and marks the end of the stream. After the archive header (level|OPTION_STREAM) there is no
+// file size. The decoder reads the payload of the frames as one sequence (see FrameReader).
+
+static constexpr uint64_t STREAM_FRAME_SIZE = UINT64_C(1) << 20;
+
+/**
+ * Writes the content of @ref packed as a frame and empties it
+ * @return the number of bytes written (the archive may be a pipe that can't tell its position)
+ */
+static auto writeFrame(File *archive, uint64_t rawSize, FileMemory *packed) -> uint64_t {
+  const uint64_t packedSize = packed->size();
+  uint64_t frameSize = packedSize + 2;
+  for( uint64_t i = rawSize; i > 0x7F; i >>= 7U ) {
+    frameSize++;
+  }
+  for( uint64_t i = packedSize; i > 0x7F; i >>= 7U ) {
+    frameSize++;
+  }
+  archive->putVLI(rawSize);
+  archive->putVLI(packedSize);
+  packed->setpos(0);
+  copyBytes(packed, archive, packedSize);
+  packed->close();
+  return frameSize;
+}
+
+// Compress a stream of unknown size
+// Returns the content size, @ref archiveSize is increased by the number of bytes written to the archive
+template<SIMDType simd>
+static auto compressStream(Shared *const shared, File *in, File *archive, uint64_t &archiveSize) -> uint64_t {
+  FileMemory packed;
+  Encoder<simd> en(shared, COMPRESS, &packed);
+  Array<uint8_t> raw(STREAM_FRAME_SIZE);
+  uint64_t contentSize = 0;
+  fprintf(stderr, "Compressing... ");
+  for( ;; ) {
+    const uint64_t n = in->blockRead(&raw[0], STREAM_FRAME_SIZE);
+    if( n == 0 ) {
+      break;
+    }
+    en.compressBytes(&en.predictorMain, &raw[0], n);
+    en.flushBuffer();
+    archiveSize += writeFrame(archive, n, &packed);
+    contentSize += n;
+  }
+  en.flush();
+  archiveSize += writeFrame(archive, 0, &packed);
+  fprintf(stderr, "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
+  return contentSize;
+}
+
+// Decompress or compare a stream
+// Only the range [offset, offset+length) is extracted (length=0: up to the end of the content)
+template<SIMDType simd>
+static void decompressStream(Shared *const shared, const char *filename, FMode fMode, File *archive, uint64_t offset, uint64_t length) {
+  FrameReader frames(archive);
+  Encoder<simd> en(shared, DECOMPRESS, &frames);
+
+  FileMapped f;
+  if( fMode == FCOMPARE ) {
+    f.open(filename, true);
+    printf("Comparing");
+  } else { //mode==FDECOMPRESS;
+    f.create(filename); // the content size is not known in advance
+    printf("Extracting");
+  }
+  printf(" %s -> ", filename);
+
+  const uint64_t endPos = length == 0 || length > UINT64_MAX - offset ? UINT64_MAX : offset + length;
+  AsyncReader asyncOriginal(&f);
+  AsyncWriter asyncOut(&f);
+  File *io = startAsyncIo(shared, fMode, &f, &asyncOriginal, &asyncOut);
+  BufferedWriter out(io);
+  BufferedReader original(io);
+  uint64_t j = 0;
+  uint64_t diffPos = 0; // 1-based position of the first mismatch
+  // the content size grows as the decoder reads ahead into the next frames
+  for( ; j < frames.getContentSize() && j < endPos; j++ ) {
+    const uint8_t c = en.decompressByte(&en.predictorMain);
+    if( j < offset ) {
+      continue;
+    }
+    if( fMode == FDECOMPRESS ) {
+      out.putChar(c);
+    } else if( c != original.getchar() ) { //compare
+      diffPos = j + 1;
+      break;
+    }
+  }
+  out.flush();
+  asyncOut.close();
+  if( j < endPos && diffPos == 0 && !frames.isLastFrame() ) {
+    quit("Unexpected end of archive.");
+  }
+
+  if( fMode == FCOMPARE && diffPos == 0 && original.getchar() != EOF) {
+    printf("file is longer\n");
+  } else if( fMode == FCOMPARE && diffPos != 0 ) {
+    printf("differ at %" PRIu64 "\n", diffPos - 1);
+  } else if( fMode == FCOMPARE ) {
+    printf("identical\n");
+  } else if( offset > j ) {
+    printf("the range offset is beyond the end of the content (%" PRIu64 " bytes)\n", j);
+  } else {
+    printf("%" PRIu64 " bytes done\n", j - offset);
+  }
+  asyncOriginal.close();
   f.close();
 }
 
@@ -1,16 +1,29 @@
 #include "NormalModel.hpp"
 
+auto NormalModel::order2LineBitsOf(const uint64_t cmSize) -> uint32_t {
+  const uint32_t bits = ilog2(static_cast<uint32_t>(std::min<uint64_t>(cmSize, UINT64_C(1) << 31))) - 2;
+  return std::min(std::max(bits, ORDER2_MIN_LINE_BITS), ORDER2_MAX_LINE_BITS);
+}
+
 NormalModel::NormalModel(Shared* const sh, const uint64_t cmSize) :
   shared(sh), 
+  order2LineBits(order2LineBitsOf(cmSize)),
   cm(sh, cmSize),
   smOrder0(sh, 255, 4, StateMap::Generic),
-  smOrder1(sh, 255 * 256, 32, StateMap::Generic),
-  smOrder2(sh, 1<<24, 1023, StateMap::Generic)
+  smOrder1(sh, 256 * NIBBLE_STATES, 32, StateMap::Generic),
+  smOrder2(sh, 16 << order2LineBits, 1023, StateMap::Generic, MemoryComponent::Order2Map)
 {
   assert(isPowerOf2(cmSize));
 }
 
-bool isSegmentBorder(uint32_t c3) {
+void NormalModel::planMemory(const uint64_t cmSize, MemoryPlan &plan) {
+  plan.add(MemoryComponent::HashTable, cmSize * sizeof(Bucket16));
+  plan.add(MemoryComponent::Order2Map, (UINT64_C(16) << order2LineBitsOf(cmSize)) * sizeof(uint32_t));
+  plan.add(MemoryComponent::StateMaps, (255 + 256 * NIBBLE_STATES) * sizeof(uint32_t));
+  plan.add(MemoryComponent::InputBuffer, LOOKAHEAD_SIZE * sizeof(LookaheadEntry));
+}
+
+static bool isSegmentBorder(uint32_t c3) {
   static constexpr uint32_t SEGMENT_BORDER_MARKERS[]{ 
     0xEFBC8C,0xE79A84,0xE38082,0xE38081,0xEFBC88,0xEFBC89,0xE59CA8,0xE698AF,
     0xE69C89,0xE5928C,0xEFBC9A,0xE782BA,0xE4BBA5,0xE3808A,0xE4BA86,0xE696BC,
@@ -20,81 +33,142 @@ bool isSegmentBorder(uint32_t c3) {
     0xE68BAC,0xE4BA9B,0xE4B894,
   };
   constexpr size_t SEGMENT_BORDER_MARKER_COUNT = sizeof(SEGMENT_BORDER_MARKERS)/sizeof(uint32_t);
-  for (size_t i = 0; i < SEGMENT_BORDER_MARKER_COUNT; i++)
-    if (SEGMENT_BORDER_MARKERS[i] == c3)
-      return true;
-  return false;
+  bool found = false;
+  for (size_t i = 0; i < SEGMENT_BORDER_MARKER_COUNT; i++) // without an early exit the compares are vectorized
+    found |= SEGMENT_BORDER_MARKERS[i] == c3;
+  return found;
 }
 
-void NormalModel::mix(Mixer &m) {
-  INJECT_SHARED_bpos
-  INJECT_SHARED_c1
-  if( bpos == 0 ) {
+void NormalModel::ByteContexts::update(const uint8_t c1, const uint32_t c4) {
+  uint64_t lastchar = static_cast<uint64_t>(c1);
+  lastchar++;
+  if (utf8left == 0) {
+
+    utf8c7 = (utf8c6 + lastchar) * PHI64;
+    utf8c6 = (utf8c5 + lastchar) * PHI64;
+    utf8c5 = (utf8c4 + lastchar) * PHI64;
+    utf8c4 = (utf8c3 + lastchar) * PHI64;
+    utf8c3 = (utf8c2 + lastchar) * PHI64;
+    utf8c2 = (utf8c1 + lastchar) * PHI64;
+    utf8c1 = (lastchar) * PHI64; // first byte of a UTF8 character, might be ascii
 
-    uint64_t lastchar = static_cast<uint64_t>(c1);
-    lastchar++;
-    if (utf8left == 0) {
+    if ((c1 >> 5) == 0b110) utf8left = 1;
+    else if ((c1 >> 4) == 0b1110) utf8left = 2;
+    else if ((c1 >> 3) == 0b11110) utf8left = 3;
+    else utf8left = 0; //ascii or utf8 error
 
-      utf8c7 = (utf8c6 + lastchar) * PHI64;
-      utf8c6 = (utf8c5 + lastchar) * PHI64;
-      utf8c5 = (utf8c4 + lastchar) * PHI64;
-      utf8c4 = (utf8c3 + lastchar) * PHI64;
-      utf8c3 = (utf8c2 + lastchar) * PHI64;
-      utf8c2 = (utf8c1 + lastchar) * PHI64;
-      utf8c1 = (lastchar) * PHI64; // first byte of a UTF8 character, might be ascii
+  }
+  else {
 
-      if ((c1 >> 5) == 0b110) utf8left = 1;
-      else if ((c1 >> 4) == 0b1110) utf8left = 2;
-      else if ((c1 >> 3) == 0b11110) utf8left = 3;
-      else utf8left = 0; //ascii or utf8 error
+    utf8c7 = (utf8c7 + lastchar) * PHI64;
+    utf8c6 = (utf8c6 + lastchar) * PHI64;
+    utf8c5 = (utf8c5 + lastchar) * PHI64;
+    utf8c4 = (utf8c4 + lastchar) * PHI64;
+    utf8c3 = (utf8c3 + lastchar) * PHI64;
+    utf8c2 = (utf8c2 + lastchar) * PHI64;
+    utf8c1 = (utf8c1 + lastchar) * PHI64;
 
-    }
-    else {
+    utf8left--;
+    if ((c1 >> 6) != 0b10)
+      utf8left = 0; //utf8 error
+  }
 
-      utf8c7 = (utf8c7 + lastchar) * PHI64;
-      utf8c6 = (utf8c6 + lastchar) * PHI64;
-      utf8c5 = (utf8c5 + lastchar) * PHI64;
-      utf8c4 = (utf8c4 + lastchar) * PHI64;
-      utf8c3 = (utf8c3 + lastchar) * PHI64;
-      utf8c2 = (utf8c2 + lastchar) * PHI64;
-      utf8c1 = (utf8c1 + lastchar) * PHI64;
-
-      utf8left--;
-      if ((c1 >> 6) != 0b10)
-        utf8left = 0; //utf8 error
-    }
+  lastByteType =
+    c1 >= '0' && c1 <= '9' ? 0 :
+    (c1 >= 'a' && c1 <= 'z') || (c1 >= 'A' && c1 <= 'Z') ? 1 :
+    (c1 < 128) ? 2 :
+    3 + utf8left; //0..6
 
-    lastByteType =
-      c1 >= '0' && c1 <= '9' ? 0 :
-      (c1 >= 'a' && c1 <= 'z') || (c1 >= 'A' && c1 <= 'Z') ? 1 :
-      (c1 < 128) ? 2 :
-      3 + utf8left; //0..6
-
-    cm.set(0, utf8c1);
-    cm.set(1, utf8c2);
-    cm.set(2, utf8c3);
-    cm.set(3, utf8c4);
-    cm.set(4, utf8c5);
-    cm.set(5, utf8c6);
-    cm.set(6, utf8c7);
-
-    uint8_t tokentype = lastByteType <= 1 ? 0 : lastByteType == 2 ? 1 : 2;
-    INJECT_SHARED_c4
-    const uint32_t c3 = c4 & 0xffffff;
-    const bool isSegmentStart = (utf8left == 0 && (c3 & 0xE0C0C0) == 0xE08080 && isSegmentBorder(c3));
-    if (isSegmentStart) {
+  uint8_t tokentype = lastByteType <= 1 ? 0 : lastByteType == 2 ? 1 : 2;
+  const uint32_t c3 = c4 & 0xffffff;
+  const bool isSegmentStart = (utf8left == 0 && (c3 & 0xE0C0C0) == 0xE08080 && isSegmentBorder(c3));
+  if (isSegmentStart) {
+    tokenHash = MUL64_1;
+    tokentype = 3;
+  }
+  else {
+    if ((tokentype != lasttokentype))
       tokenHash = MUL64_1;
-      tokentype = 3;
+    tokenHash = (tokenHash + lastchar) * PHI64;
+  }
+  lasttokentype = tokentype;
+}
+
+void NormalModel::lookahead(const uint8_t *data, const uint32_t n) {
+  assert(shared->State.bitPosition == 0 && lookaheadPos == lookaheadEnd && n <= LOOKAHEAD_SIZE);
+  if (lookaheadBuffer.size() == 0) {
+    lookaheadBuffer.resize(LOOKAHEAD_SIZE);
+  }
+  // the same updates as in mix(), in a tight loop without the coding in between
+  ByteContexts state = contexts;
+  uint8_t c1 = shared->State.c1;
+  uint32_t c4 = shared->State.c4;
+  for (uint32_t i = 0; i < n; i++) {
+    state.update(c1, c4);
+    const uint64_t hashes[nCM] = {state.utf8c1, state.utf8c2, state.utf8c3, state.utf8c4, state.utf8c5, state.utf8c6, state.utf8c7, state.tokenHash};
+    LookaheadEntry &entry = lookaheadBuffer[i];
+    for (int j = 0; j < nCM; j++) {
+      entry.tableIndex[j] = cm.getTableIndex(hashes[j]);
+      entry.tableChecksum[j] = cm.getTableChecksum(hashes[j]);
+    }
+    entry.order2Context = finalize64(state.utf8c1, order2LineBits);
+    entry.utf8left = state.utf8left;
+    entry.lastByteType = state.lastByteType;
+    entry.c = c1 = data[i];
+    c4 = c4 << 8 | c1;
+  }
+  lookaheadContexts = state;
+  lookaheadPos = 0;
+  lookaheadEnd = n;
+  for (uint32_t i = 0; i < LOOKAHEAD_PREFETCH_DISTANCE && i < n; i++) {
+    for (int j = 0; j < nCM; j++) {
+      cm.prefetch(lookaheadBuffer[i].tableIndex[j], lookaheadBuffer[i].c);
+    }
+  }
+}
+
+template<SIMDType simd>
+void NormalModel::mix(Mixer &m) {
+  INJECT_SHARED_bpos
+  INJECT_SHARED_c1
+  if( bpos == 0 ) {
+    if (lookaheadPos < lookaheadEnd) {
+      if (lookaheadPos + LOOKAHEAD_PREFETCH_DISTANCE < lookaheadEnd) {
+        const LookaheadEntry &ahead = lookaheadBuffer[lookaheadPos + LOOKAHEAD_PREFETCH_DISTANCE];
+        for (int i = 0; i < nCM; i++) {
+          cm.prefetch(ahead.tableIndex[i], ahead.c);
+        }
+        smOrder2.prefetch(order2Index(ahead.order2Context, 0));
+        smOrder2.prefetch(order2Index(ahead.order2Context, nibbleIndex(4, ahead.c >> 4 | 16)));
+      }
+      const LookaheadEntry &entry = lookaheadBuffer[lookaheadPos];
+      for (int i = 0; i < nCM; i++) {
+        cm.set(i, entry.tableIndex[i], entry.tableChecksum[i]);
+      }
+      order2Context = entry.order2Context;
+      contexts.utf8left = entry.utf8left;
+      contexts.lastByteType = entry.lastByteType;
+      if (++lookaheadPos == lookaheadEnd) {
+        contexts = lookaheadContexts;
+      }
     }
     else {
-      if ((tokentype != lasttokentype))
-        tokenHash = MUL64_1;
-      tokenHash = (tokenHash + lastchar) * PHI64;
+      INJECT_SHARED_c4
+      contexts.update(c1, c4);
+      cm.set(0, contexts.utf8c1);
+      cm.set(1, contexts.utf8c2);
+      cm.set(2, contexts.utf8c3);
+      cm.set(3, contexts.utf8c4);
+      cm.set(4, contexts.utf8c5);
+      cm.set(5, contexts.utf8c6);
+      cm.set(6, contexts.utf8c7);
+      cm.set(7, contexts.tokenHash);
+      order2Context = finalize64(contexts.utf8c1, order2LineBits);
     }
-    cm.set(7, tokenHash);
-    lasttokentype = tokentype;
   }
-  cm.mix(m);
+  const uint8_t utf8left = contexts.utf8left;
+  const uint8_t lastByteType = contexts.lastByteType;
+  cm.template mix<simd>(m);
   
   INJECT_SHARED_c0
   int p1, st;
@@ -104,12 +178,17 @@ void NormalModel::mix(Mixer &m) {
   m.add(st >> 1);
 
   uint32_t c = ((c1 & 0xc0) == 0x80 ? 0x80 + utf8left : c1);
-  p1 = smOrder1.p1((c0 - 1) << 8 | c); 
+  const uint32_t nibbleCtx = nibbleIndex(bpos, c0);
+  p1 = smOrder1.p1(c * NIBBLE_STATES + nibbleCtx);
   m.add((p1 - 2048) >> 2);
   st = stretch(p1);
   m.add(st >> 1);
 
-  p1 = smOrder2.p1(finalize64(utf8c1, 24) ^ c0);
+  p1 = smOrder2.p1(order2Index(order2Context, nibbleCtx));
+  if (bpos == 3) { // the line of the second nibble: prefetch it for both values of the next bit
+    smOrder2.prefetch(order2Index(order2Context, nibbleIndex(4, c0 << 1)));
+    smOrder2.prefetch(order2Index(order2Context, nibbleIndex(4, c0 << 1 | 1)));
+  }
   m.add((p1 - 2048) >> 2);
   st = stretch(p1);
   m.add(st >> 1);
@@ -155,3 +234,37 @@ void NormalModel::mix(Mixer &m) {
 
 }
 
+void NormalModel::saveState(File *f) {
+  assert(lookaheadPos == lookaheadEnd);
+  const uint64_t hashes[] = {contexts.utf8c1, contexts.utf8c2, contexts.utf8c3, contexts.utf8c4, contexts.utf8c5, contexts.utf8c6, contexts.utf8c7, contexts.tokenHash};
+  for( uint64_t h: hashes ) {
+    f->put64(h);
+  }
+  f->putChar(contexts.utf8left);
+  f->putChar(contexts.lastByteType);
+  f->putChar(contexts.lasttokentype);
+  cm.saveState(f);
+  smOrder0.saveState(f);
+  smOrder1.saveState(f);
+  smOrder2.saveState(f);
+}
+
+void NormalModel::loadState(File *f) {
+  uint64_t *hashes[] = {&contexts.utf8c1, &contexts.utf8c2, &contexts.utf8c3, &contexts.utf8c4, &contexts.utf8c5, &contexts.utf8c6, &contexts.utf8c7, &contexts.tokenHash};
+  for( uint64_t *h: hashes ) {
+    *h = f->get64();
+  }
+  contexts.utf8left = static_cast<uint8_t>(f->getchar());
+  contexts.lastByteType = static_cast<uint8_t>(f->getchar());
+  contexts.lasttokentype = static_cast<uint8_t>(f->getchar());
+  cm.loadState(f);
+  smOrder0.loadState(f);
+  smOrder1.loadState(f);
+  smOrder2.loadState(f);
+}
+
+template void NormalModel::mix<SIMDType::SIMD_NONE>(Mixer &m);
+template void NormalModel::mix<SIMDType::SIMD_SSE2>(Mixer &m);
+template void NormalModel::mix<SIMDType::SIMD_SSSE3>(Mixer &m);
+template void NormalModel::mix<SIMDType::SIMD_AVX2>(Mixer &m);
+template void NormalModel::mix<SIMDType::SIMD_NEON>(Mixer &m);
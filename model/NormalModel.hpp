@@ -10,21 +10,99 @@
  * Note: order 7+ contexts are modeled by matchModel as well.
  */
 class NormalModel {
+public:
+    /**
+     * Compression only: the contexts of up to this many bytes are computed ahead of coding them (see lookahead())
+     */
+    static constexpr uint32_t LOOKAHEAD_SIZE = 4096;
+
+    /**
+     * While coding a byte from the lookahead buffer, the buckets of the byte this many positions later are prefetched
+     */
+    static constexpr uint32_t LOOKAHEAD_PREFETCH_DISTANCE = 2;
+
 private:
     static constexpr int nCM = ContextMap2::C; // 8
     static constexpr int nSM = 8;
+
+    /**
+     * The bit states of a byte context are grouped by nibbles: 16 states (a cache line of a StateMap) for the
+     * first nibble, and 16 states for the second nibble after each of the 16 first nibbles: 17 lines per byte context.
+     * Coding a byte touches 2 cache lines of a StateMap instead of up to 8.
+     */
+    static constexpr uint32_t NIBBLE_STATES = 17 * 16; // 272
+
+    /**
+     * smOrder2 has 2^n lines of 16 states (2^(n+4) contexts): from 2^15 lines (2 MB) at level 1
+     * to 2^20 lines (64 MB) at level 6 and above
+     */
+    static constexpr uint32_t ORDER2_MIN_LINE_BITS = 15;
+    static constexpr uint32_t ORDER2_MAX_LINE_BITS = 20;
+
+    /**
+     * @return the number of line bits of smOrder2: its size is a quarter of the ContextMap2 hash table of @ref cmSize buckets
+     */
+    static auto order2LineBitsOf(uint64_t cmSize) -> uint32_t;
+
+    /**
+     * @return the index of the state of the partial byte @ref c0 at bit position @ref bpos among the
+     * @ref NIBBLE_STATES states of its byte context (0..271, where 0 and 16 are unused)
+     */
+    static auto nibbleIndex(uint32_t bpos, uint32_t c0) -> uint32_t {
+      if( bpos < 4 ) {
+        return c0; // 1..15: line 0
+      }
+      const uint32_t bits = bpos - 4;
+      return ((c0 >> bits) - 15) << 4 | 1U << bits | (c0 & ((1U << bits) - 1)); // lines 1..16 by the first nibble
+    }
+
+    /**
+     * @return the context of smOrder2 for the state @ref nibbleCtx (see nibbleIndex()) of the last character
+     * of line @ref ctx: the lines of the second nibble follow the line of the first nibble
+     */
+    [[nodiscard]] auto order2Index(const uint32_t ctx, const uint32_t nibbleCtx) const -> uint32_t {
+      return ((ctx << 4) + nibbleCtx) & ((16U << order2LineBits) - 1);
+    }
+
+    /**
+     * The state of the whole byte contexts, updated at each byte boundary by the last byte
+     */
+    struct ByteContexts {
+      uint64_t utf8c1{}; //last character (UTF8)
+      uint64_t utf8c2{};
+      uint64_t utf8c3{};
+      uint64_t utf8c4{};
+      uint64_t utf8c5{};
+      uint64_t utf8c6{};
+      uint64_t utf8c7{};
+      uint64_t tokenHash{};
+      uint8_t utf8left{}; //how many bytes are left from the current UTF8 character
+      uint8_t lastByteType{};
+      uint8_t lasttokentype{};
+
+      void update(uint8_t c1, uint32_t c4);
+    };
+
+    /**
+     * What mix() needs at a byte boundary, computed ahead of coding by lookahead()
+     */
+    struct LookaheadEntry {
+      uint64_t tableIndex[nCM];
+      uint16_t tableChecksum[nCM];
+      uint32_t order2Context;
+      uint8_t utf8left;
+      uint8_t lastByteType;
+      uint8_t c; /**< the byte to be coded in these contexts */
+    };
+
     Shared * const shared;
-    uint64_t utf8c1{}; //last character (UTF8)
-    uint64_t utf8c2{};
-    uint64_t utf8c3{};
-    uint64_t utf8c4{};
-    uint64_t utf8c5{};
-    uint64_t utf8c6{};
-    uint64_t utf8c7{};
-    uint64_t tokenHash{};
-    uint8_t utf8left{}; //how many bytes are left from the current UTF8 character
-    uint8_t lastByteType{};
-    uint8_t lasttokentype{};
+    ByteContexts contexts;
+    const uint32_t order2LineBits; /**< smOrder2 has 2^order2LineBits lines */
+    uint32_t order2Context{}; /**< hash of the last (UTF8) character for smOrder2: the index of the line of its first nibble */
+    Array<LookaheadEntry, 64> lookaheadBuffer{0, MemoryComponent::InputBuffer}; /**< allocated by the first lookahead() */
+    ByteContexts lookaheadContexts; /**< the state after the last byte of the lookahead buffer */
+    uint32_t lookaheadPos{};
+    uint32_t lookaheadEnd{};
 public:
     static constexpr int MIXERINPUTS = nCM * (ContextMap2::MIXERINPUTS) + nSM; // 32
     static constexpr int MIXERCONTEXTS =
@@ -36,12 +114,34 @@ public:
     static constexpr int MIXERCONTEXTSETS = 4;
     NormalModel(Shared* const sh, const uint64_t cmSize);
 
+    /**
+     * Adds the bytes allocated by a NormalModel with a ContextMap2 of @ref cmSize buckets to @ref plan
+     */
+    static void planMemory(uint64_t cmSize, MemoryPlan &plan);
+
     ContextMap2 cm;
     StateMap smOrder0;
     StateMap smOrder1;
     StateMap smOrder2;
 
+    template<SIMDType simd>
     void mix(Mixer &m);
+
+    /**
+     * Computes the contexts of the next @ref n bytes before they are coded (the bytes are known when compressing).
+     * The following mix() calls at byte boundaries take them from the lookahead buffer, and the buckets of the
+     * bytes ahead are prefetched. The predictions are the same as without the lookahead.
+     * Must be called at a byte boundary, and the @ref n bytes must be coded before the next call or saveState().
+     * @param data the next bytes to be coded
+     * @param n number of bytes, at most @ref LOOKAHEAD_SIZE
+     */
+    void lookahead(const uint8_t *data, uint32_t n);
+
+    /**
+     * Writes/reads the complete model state for a model snapshot (at a byte boundary).
+     */
+    void saveState(File *f);
+    void loadState(File *f);
 };
 
 #endif //PAQ8PX_NORMALMODEL_HPP
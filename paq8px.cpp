@@ -24,8 +24,40 @@
 #include "filter/Filters.hpp"
 #include "simd.hpp"
 
+// A fat binary (see build/build-linux.sh) links the program compiled for each x86-64 microarchitecture level.
+// In such a variant (ISA_VARIANT is its name) processCommandLine() is named after the variant and main() is in the launcher.
+#ifdef ISA_VARIANT
+#define ISA_VARIANT_ENTRY2(variant) processCommandLine_##variant
+#define ISA_VARIANT_ENTRY(variant) ISA_VARIANT_ENTRY2(variant)
+#define processCommandLine ISA_VARIANT_ENTRY(ISA_VARIANT)
+#endif
+
 typedef enum { DoNone, DoCompress, DoExtract, DoCompare } WHATTODO;
 
+#define DEFAULT_BLOCK_SIZE_TEXT "64 MB"
+static constexpr uint64_t DEFAULT_BLOCK_SIZE = UINT64_C(64) << 20;
+
+/**
+ * The memory of the process that is not allocated by the models: the code, the stacks and the C library
+ */
+static constexpr uint64_t PROGRAM_MEMORY = UINT64_C(4) << 20;
+
+/**
+ * The file buffers (or the frames of a stream) of a model that doesn't code blocks
+ */
+static constexpr uint64_t IO_BUFFERS = UINT64_C(2) << 20;
+
+/**
+ * @return the memory plan of a model with a ContextMap2 of @ref mem buckets (see Predictor::planMemory()) with its I/O:
+ * a block of @ref blockSize bytes and its compressed content (at most about as large), or the file buffers
+ */
+template<SIMDType simd>
+static auto planMemory(const uint64_t mem, const uint64_t blockSize) -> MemoryPlan {
+  MemoryPlan plan = Predictor<simd>::planMemory(mem);
+  plan.add(MemoryComponent::Other, blockSize != 0 ? 2 * blockSize : IO_BUFFERS);
+  return plan;
+}
+
 static void printHelp() {
   printf("\n"
          "Free under GPL, http://www.gnu.org/licenses/gpl.txt\n\n"
@@ -42,14 +74,18 @@ static void printHelp() {
          "      Specifies how much memory to use. Approximately the same amount of memory\n"
          "      will be used for both compression and decompression.\n"
          "\n"
-         "      -1 -2 -3 = compress using less memory (75, 83, 99 MB)\n"
-         "      -4 -5 -6 -7 -8 -9 = use more memory (131, 195, 323, 579, 1091, 2115 MB)\n"
+         "      -1 -2 -3 = compress using less memory (13, 23, 43 MB)\n"
+         "      -4 -5 -6 -7 -8 -9 = use more memory (83, 163, 323, 579, 1091, 2115 MB)\n"
          "      -10  -11  -12     = use even more memory (4163, 8259, 16451 MB)\n"
+         "      -13  -14  -15  -16 = for large-memory servers (32835, 65603, 131139,\n"
+         "                           262211 MB)\n"
+         "      -auto = use as much memory as the input size needs, but at most 3/4 of\n"
+         "              the memory available to the process (see -mem)\n"
          "\n"
          "\n"
          "    INPUTSPEC:\n"
          "\n"
-         "    The input may be a FILE or a PATH/FILE.\n"
+         "    The input may be a FILE or a PATH/FILE, or - to compress stdin.\n"
          "\n"
          "    Only file content and the file size is kept in the archive. Filename,\n"
          "    path, date and any file attributes or permissions are not stored.\n"
@@ -65,6 +101,10 @@ static void printHelp() {
          "    When OUTPUTSPEC is a folder the archive file will be generated from\n"
          "    the input filename and will be created in the specified folder.\n"
          "    If the archive file already exists it will be overwritten.\n"
+         "    When OUTPUTSPEC is - the archive is written to stdout (messages go to stderr).\n"
+         "    When the input or the output is - the archive is written as a stream of\n"
+         "    frames (the content size need not be known in advance), e.g.:\n"
+         "      mysqldump db | " PROGNAME " -8 - - | ...\n"
          "\n"
          "\n"
          "To extract (decompress contents):\n"
@@ -76,6 +116,15 @@ static void printHelp() {
          "    same as ARCHIVEFILE without the last extension (e.g. without ." PROGNAME PROGVERSION")\n"
          "    When OUTPUTPATH does not exist it will be created.\n"
          "    Any required folders will be created.\n"
+         "    The archive is read from stdin when ARCHIVEFILE is -, and the content is\n"
+         "    written to stdout when OUTPUTFILE is - (messages go to stderr).\n"
+         "\n"
+         "    -range OFFSET:LEN\n"
+         "    Extract only LEN bytes starting at OFFSET (a K, M or G suffix may be used).\n"
+         "    From archives created with -block only the blocks covering the range are\n"
+         "    decoded. From other archives decoding resumes from the last model snapshot\n"
+         "    before OFFSET (see -snapshot) when ARCHIVEFILE" SNAPSHOT_EXTENSION " exists, otherwise\n"
+         "    the content before OFFSET must be decoded as well.\n"
          "\n"
          "\n"
          "To test:\n"
@@ -90,6 +139,48 @@ static void printHelp() {
          "    -v\n"
          "    Print more detailed (verbose) information to screen.\n"
          "\n"
+         "    -block SIZE\n"
+         "    Compress the input as independent blocks of SIZE bytes (a K, M or G suffix\n"
+         "    may be used) so that the blocks can be processed in parallel. Smaller\n"
+         "    blocks compress worse. The archive content depends only on the block size.\n"
+         "\n"
+         "    -threads N\n"
+         "    Use N worker threads for compressing, extracting or testing blocks. Each\n"
+         "    thread uses the memory of the selected level. When used without -block\n"
+         "    for compression, the input is split into blocks of " DEFAULT_BLOCK_SIZE_TEXT ".\n"
+         "\n"
+         "    -snapshot INTERVAL\n"
+         "    When compressing without -block: save a snapshot of the model state at every\n"
+         "    INTERVAL bytes (a K, M or G suffix may be used) to ARCHIVEFILE" SNAPSHOT_EXTENSION "\n"
+         "    for faster -range extraction. Each snapshot is about as large as the memory\n"
+         "    used by the selected level.\n"
+         "\n"
+         "    -mem BUDGET\n"
+         "    Limit the memory of the models to BUDGET bytes (a K, M or G suffix may be\n"
+         "    used) in total for all threads when compressing. With -auto it replaces the\n"
+         "    available memory of the system and of the cgroup of the process. The chosen\n"
+         "    size is stored in the archive: extraction uses the same amount of memory.\n"
+         "\n"
+         "    -async\n"
+         "    Read and write the files on separate threads, so that coding doesn't wait\n"
+         "    for the disk. Not used with -block or -threads.\n"
+         "\n"
+         "    -prefault\n"
+         "    Fault in the pages of the large tables of the models with all the threads\n"
+         "    of the machine before coding, instead of on their first use while coding.\n"
+         "\n"
+         "    -numa local|interleave\n"
+         "    Place the large tables of the models on the NUMA nodes of the machine.\n"
+         "    local: each coder runs on the CPUs of one node (worker N on node N modulo\n"
+         "    the number of nodes with -block or -threads) and its tables are allocated\n"
+         "    on that node. interleave: the tables are spread across all the nodes, for\n"
+         "    when a model is larger than the memory of a node. Linux only.\n"
+         "\n"
+         "    -nocache\n"
+         "    Read and write the files as sequential streams and drop them from the page\n"
+         "    cache behind the cursor, so that huge files don't evict other cached data\n"
+         "    (Linux only).\n"
+         "\n"
          "    -simd [NONE|SSE2|SSSE3|AVX2|NEON]\n"
          "    Overrides detected SIMD instruction set for neural network operations\n"
          "\n"
@@ -143,12 +234,187 @@ static void printCommand(const WHATTODO &whattodo) {
   printf("\n");
 }
 
-static void printOptions(Shared *shared) {
+static void printOptions(Shared *shared, const MemoryPlan &plan, uint64_t blockSize, uint32_t threads, uint64_t snapshotInterval) {
   printf(" Level          = %d\n", shared->level);
+  printf(" Model memory   = %" PRIu64 " MB per thread (%" PRIu64 " hash table buckets)\n", plan.total() >> 20, shared->mem);
+  if( blockSize != 0 ) {
+    printf(" Block size     = %" PRIu64 " bytes\n", blockSize);
+  }
+  if( snapshotInterval != 0 ) {
+    printf(" Snapshots      = every %" PRIu64 " bytes\n", snapshotInterval);
+  }
+  printf(" Threads        = %u\n", threads);
 }
 
-auto processCommandLine(int argc, char **argv) -> int {
+/**
+ * Closes the archive after the reader/writer thread (if any) finished with it
+ */
+static void closeArchive(File *archive, AsyncReader *reader, AsyncWriter *writer, bool printIoWait) {
+  writer->close();
+  reader->close();
+  archive->close();
+  if( printIoWait ) {
+    printf("Coder waited for I/O : %1.3f sec\n", ProgramChecker::getInstance()->getIoWaitTime());
+  }
+}
+
+/**
+ * Parses a size such as 65536, 64K, 64M or 1G that is followed by @ref terminator
+ * @return the position after the terminator, or nullptr on error
+ */
+static auto parseSize(const char *s, uint64_t &size, const char terminator = 0) -> const char * {
+  size = 0;
+  int i = 0;
+  for( ; s[i] >= '0' && s[i] <= '9'; i++ ) {
+    size = size * 10 + (s[i] - '0');
+    if( size > (UINT64_C(1) << 40) ) {
+      return nullptr;
+    }
+  }
+  if( i == 0 ) {
+    return nullptr;
+  }
+  const char unit = static_cast<char>(toupper(s[i]));
+  if( unit == 'K' ) {
+    size <<= 10;
+  } else if( unit == 'M' ) {
+    size <<= 20;
+  } else if( unit == 'G' ) {
+    size <<= 30;
+  }
+  if( unit == 'K' || unit == 'M' || unit == 'G' ) {
+    i++;
+  }
+  if( s[i] != terminator ) {
+    return nullptr;
+  }
+  return terminator == 0 ? &s[i] : &s[i + 1];
+}
+
+/**
+ * Plans the model memory (Shared::mem) for -auto and -mem.
+ * A model is planned by component (see planMemory()): the mixers, smOrder0/1 and the buffers have fixed sizes,
+ * the I/O depends on the block size, the hash table and smOrder2 scale with Shared::mem (smOrder2 is a quarter
+ * of the hash table, from 2 MB to 64 MB). The hash table starts at the memory of the level, or with -auto at the
+ * smallest size with a bucket for each byte of the input (or of a block): more buckets don't improve the compression
+ * measurably. When the input size is unknown it starts at the memory of level 12, the levels above are for known
+ * inputs of many GB. Then it's halved until @ref threads models and PROGRAM_MEMORY fit in the budget: @ref budget bytes
+ * (-mem) or, with -auto, 3/4 of availableMemory().
+ * @param inputSize the number of bytes coded by a model, 0 when unknown (stdin)
+ */
+template<SIMDType simd>
+static void sizeModelMemory(Shared *shared, const bool autoSize, const uint64_t inputSize, const uint64_t blockSize, uint64_t budget,
+                            const uint32_t threads) {
+  uint32_t bits = !autoSize ? shared->memBits() : inputSize != 0 ? MAX_MEM_BITS : 16 + 12;
+  if( autoSize && inputSize != 0 ) {
+    uint32_t inputBits = MIN_MEM_BITS;
+    while( (UINT64_C(1) << inputBits) < inputSize && inputBits < MAX_MEM_BITS ) {
+      inputBits++;
+    }
+    bits = std::min(bits, inputBits);
+  }
+  const bool budgetGiven = budget != 0;
+  if( !budgetGiven ) {
+    budget = autoSize && availableMemory() != 0 ? availableMemory() / 4 * 3 : UINT64_MAX;
+  }
+  const auto needed = [&](const uint32_t b) { return planMemory<simd>(UINT64_C(1) << b, blockSize).total() * threads + PROGRAM_MEMORY; };
+  while( bits > MIN_MEM_BITS && needed(bits) > budget ) {
+    bits--;
+  }
+  if( budgetGiven && needed(bits) > budget ) {
+    printf("The -mem budget is too small: at least %" PRIu64 " MB is needed.", (needed(bits) + (1 << 20) - 1) >> 20);
+    quit();
+  }
+  if( autoSize ) { // the level of the same memory, it's in the archive header
+    shared->init(static_cast<uint8_t>(std::min(std::max(static_cast<int>(bits) - 16, 1), static_cast<int>(MAX_LEVEL))));
+  }
+  shared->setMem(UINT64_C(1) << bits);
+}
+
+/**
+ * @return true for the switches that take a value (the next argument): processCommandLine(), isOutputStdout() and
+ * getSelectedSimdIset() skip the values of the same switches
+ */
+static auto switchTakesValue(const char *name) -> bool {
+  static const char *const switches[] = {"-block", "-range", "--range", "-snapshot", "-threads", "-simd", "-mem", "-numa"};
+  for( const char *s: switches ) {
+    if( strcasecmp(name, s) == 0 ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Determines if the output (the archive or the extracted content) is stdout, i.e. the second file name is "-".
+ * The switches that take a value are skipped (see switchTakesValue()).
+ */
+static auto isOutputStdout(int argc, char **argv) -> bool {
+  int fileNames = 0;
+  for( int i = 1; i < argc; i++ ) {
+    if( argv[i][0] == '-' && argv[i][1] != 0 ) {
+      if( switchTakesValue(argv[i]) ) {
+        i++;
+      }
+    } else if( ++fileNames == 2 ) {
+      return strcmp(argv[i], "-") == 0;
+    }
+  }
+  return false;
+}
+
+/**
+ * @return the instruction set level (as given by simdDetect()) of an instruction set name of the -simd switch, -1 if it's invalid
+ */
+static auto getSimdIset(const char *name) -> int {
+  if( strcasecmp(name, "NONE") == 0 ) {
+    return 0;
+  }
+  if( strcasecmp(name, "SSE2") == 0 ) {
+    return 3;
+  }
+  if( strcasecmp(name, "SSSE3") == 0 ) {
+    return 5;
+  }
+  if( strcasecmp(name, "AVX2") == 0 ) {
+    return 9;
+  }
+  if( strcasecmp(name, "NEON") == 0 ) {
+    return 11;
+  }
+  return -1;
+}
+
+/**
+ * Determines the instruction set selected by the -simd switch (-1: none or invalid, it's reported by processCommandLine()).
+ * The switches that take a value are skipped (see switchTakesValue()).
+ */
+static auto getSelectedSimdIset(int argc, char **argv) -> int {
+  int simdIset = -1;
+  for( int i = 1; i < argc; i++ ) {
+    if( argv[i][0] == '-' && argv[i][1] != 0 ) {
+      if( strcasecmp(argv[i], "-simd") == 0 && i + 1 < argc ) {
+        simdIset = getSimdIset(argv[i + 1]);
+      }
+      if( switchTakesValue(argv[i]) ) {
+        i++;
+      }
+    }
+  }
+  return simdIset;
+}
+
+/**
+ * The whole program compiled for instruction set @ref simd: the models, the mixers and the coder are called directly
+ */
+template<SIMDType simd>
+static auto processCommandLine(int argc, char **argv) -> int {
   ProgramChecker *programChecker = ProgramChecker::getInstance();
+  // messages must go to stderr when the data goes to stdout: do it before anything is printed
+  if( isOutputStdout(argc, argv) && !FileDisk::redirectStdout() ) {
+    fprintf(stderr, "Unable to redirect stdout.\n");
+    return 1;
+  }
   Shared shared;
   try {
 
@@ -166,8 +432,15 @@ auto processCommandLine(int argc, char **argv) -> int {
     // Parse command line arguments
     WHATTODO whattodo = DoNone;
     bool verbose = false;
-    int c = 0;
     int simdIset = -1; //simd instruction set to use
+    uint64_t blockSize = 0; //0: the input is compressed as a single stream
+    uint32_t threads = 0; //0: not specified
+    uint64_t rangeOffset = 0;
+    uint64_t rangeLength = 0; //0: extract the whole content
+    uint64_t snapshotInterval = 0; //0: no model snapshots
+    bool autoSize = false; //-auto: the model memory is sized from the input size and the available memory
+    uint64_t memBudget = 0; //0: no -mem
+    bool prefault = false; //-prefault: the large tables are faulted in before coding
 
     FileName input;
     FileName output;
@@ -177,9 +450,10 @@ auto processCommandLine(int argc, char **argv) -> int {
 
     for( int i = 1; i < argc; i++ ) {
       int argLen = static_cast<int>(strlen(argv[i]));
-      if( argv[i][0] == '-' ) {
-        if( argLen == 1 ) {
-          quit("Empty command.");
+      if( argv[i][0] == '-' && argLen > 1 ) { // a single "-" is a file name: stdin or stdout
+        if( switchTakesValue(argv[i]) && i + 1 == argc ) {
+          printf("The %s switch requires a value.", argv[i]);
+          quit();
         }
         if( argv[i][1] >= '0' && argv[i][1] <= '9' ) { // first  digit of level
           if( whattodo != DoNone ) {
@@ -191,11 +465,19 @@ auto processCommandLine(int argc, char **argv) -> int {
             level = level*10 + argv[i][2] - '0';
             j++;
           }
-          if (level < 1 || level > 12) {
-            quit("Compression level must be between 1 and 12.");
+          if (level < 1 || level > MAX_LEVEL) {
+            printf("Compression level must be between 1 and %d.", MAX_LEVEL);
+            quit();
           }
           shared.init(level);
           whattodo = DoCompress;
+        } else if( strcasecmp(argv[i], "-auto") == 0 ) {
+          if( whattodo != DoNone ) {
+            quit("Only one command may be specified.");
+          }
+          autoSize = true;
+          shared.init(12); // until sizeModelMemory()
+          whattodo = DoCompress;
         } else if( strcasecmp(argv[i], "-d") == 0 ) {
           if( whattodo != DoNone ) {
             quit("Only one command may be specified.");
@@ -208,28 +490,59 @@ auto processCommandLine(int argc, char **argv) -> int {
           whattodo = DoCompare;
         } else if( strcasecmp(argv[i], "-v") == 0 ) {
           verbose = true;
-        } else if( strcasecmp(argv[i], "-simd") == 0 ) {
-          if( ++i == argc ) {
-            quit("The -simd switch requires an instruction set name (NONE,SSE2,SSSE3, AVX2, NEON).");
-          }
-          if( strcasecmp(argv[i], "NONE") == 0 ) {
-            simdIset = 0;
-          } else if( strcasecmp(argv[i], "SSE2") == 0 ) {
-            simdIset = 3;
-          } else if( strcasecmp(argv[i], "SSSE3") == 0 ) {
-            simdIset = 5;
-         } else if( strcasecmp(argv[i], "AVX2") == 0 ) {
-            simdIset = 9;
-         } else if (strcasecmp(argv[i], "NEON") == 0) {
-            simdIset = 11;
+        } else if( strcasecmp(argv[i], "-async") == 0 ) {
+          shared.asyncIo = true;
+        } else if( strcasecmp(argv[i], "-prefault") == 0 ) {
+          prefault = true;
+        } else if( strcasecmp(argv[i], "-numa") == 0 ) {
+          i++;
+          if( strcasecmp(argv[i], "local") == 0 ) {
+            shared.numaPolicy = NumaPolicy::Local;
+          } else if( strcasecmp(argv[i], "interleave") == 0 ) {
+            shared.numaPolicy = NumaPolicy::Interleave;
           } else {
+            quit("Invalid -numa policy. Use local or interleave.");
+          }
+        } else if( strcasecmp(argv[i], "-nocache") == 0 ) {
+          FileDisk::setDropCache(true);
+        } else if( strcasecmp(argv[i], "-block") == 0 ) {
+          i++;
+          if( parseSize(argv[i], blockSize) == nullptr || blockSize == 0 ) {
+            quit("Invalid -block size. Use e.g. -block 16M");
+          }
+        } else if( strcasecmp(argv[i], "-range") == 0 || strcasecmp(argv[i], "--range") == 0 ) {
+          i++;
+          const char *len = parseSize(argv[i], rangeOffset, ':');
+          if( len == nullptr || parseSize(len, rangeLength) == nullptr || rangeLength == 0 ) {
+            quit("Invalid -range. Use e.g. -range 1G:16M");
+          }
+        } else if( strcasecmp(argv[i], "-snapshot") == 0 ) {
+          i++;
+          if( parseSize(argv[i], snapshotInterval) == nullptr || snapshotInterval == 0 ) {
+            quit("Invalid -snapshot interval. Use e.g. -snapshot 256M");
+          }
+        } else if( strcasecmp(argv[i], "-mem") == 0 ) {
+          i++;
+          if( parseSize(argv[i], memBudget) == nullptr || memBudget == 0 ) {
+            quit("Invalid -mem budget. Use e.g. -mem 2G");
+          }
+        } else if( strcasecmp(argv[i], "-threads") == 0 ) {
+          i++;
+          threads = static_cast<uint32_t>(atoi(argv[i]));
+          if( threads < 1 || threads > 1024 ) {
+            quit("Number of threads must be between 1 and 1024.");
+          }
+        } else if( strcasecmp(argv[i], "-simd") == 0 ) {
+          i++;
+          simdIset = getSimdIset(argv[i]);
+          if( simdIset < 0 ) {
             quit("Invalid -simd option. Use -simd NONE, -simd SSE2, -simd SSSE3, -simd AVX2 or -simd NEON.");
           }
         } else {
           printf("Invalid command: %s", argv[i]);
           quit();
         }
-      } else { //this parameter does not begin with a dash ("-") -> it must be a folder/filename
+      } else { //this parameter does not begin with a dash ("-") -> it must be a folder/filename (or "-")
         if( input.strsize() == 0 ) {
           input += argv[i];
           input.replaceSlashes();
@@ -256,18 +569,8 @@ auto processCommandLine(int argc, char **argv) -> int {
       printSimdInfo(simdIset, detectedSimdIset);
     }
 
-    // Set highest or user selected vectorization mode
-    if (simdIset == 11) {
-      shared.chosenSimd = SIMDType::SIMD_NEON;
-    } else if (simdIset >= 9) {
-      shared.chosenSimd = SIMDType::SIMD_AVX2;
-    } else if (simdIset >= 5) {
-      shared.chosenSimd = SIMDType::SIMD_SSSE3;
-    } else if( simdIset >= 3 ) {
-      shared.chosenSimd = SIMDType::SIMD_SSE2;
-    } else {
-      shared.chosenSimd = SIMDType::SIMD_NONE;
-    }
+    // highest or user selected vectorization mode (see the dispatch in processCommandLine())
+    shared.chosenSimd = simd;
 
     if( verbose ) {
       printf("\n");
@@ -281,7 +584,8 @@ auto processCommandLine(int argc, char **argv) -> int {
     // Successfully parsed command line arguments
     // Let's check their validity
     if( whattodo == DoNone ) {
-      quit("A command switch is required: -0..-12 to compress, -d to decompress, -t to test, -l to list.");
+      printf("A command switch is required: -1..-%d or -auto to compress, -d to decompress, -t to test.", MAX_LEVEL);
+      quit();
     }
     if( input.strsize() == 0 ) {
       printf("\nAn %s is required %s.\n", whattodo == DoCompress ? "input file" : "archive filename",
@@ -292,29 +596,33 @@ auto processCommandLine(int argc, char **argv) -> int {
 
 
     int pathType = 0;
+    const bool stdinInput = strcmp(input.c_str(), "-") == 0;
+    const bool stdoutOutput = strcmp(output.c_str(), "-") == 0;
 
     // Separate paths from input filename/directory name
-    pathType = examinePath(input.c_str());
-    if( pathType == 2 || pathType == 4 ) {
-      printf("\nSpecified input is a directory but should be a file: %s", input.c_str());
-      quit();
-    }
-    if( pathType == 3 ) {
-      printf("\nSpecified input file does not exist: %s", input.c_str());
-      quit();
-    }
-    if( pathType == 0 ) {
-      printf("\nThere is a problem with the specified input file: %s", input.c_str());
-      quit();
-    }
-    if( input.lastSlashPos() >= 0 ) {
-      inputPath += input.c_str();
-      inputPath.keepPath();
-      input.keepFilename();
+    if( !stdinInput ) {
+      pathType = examinePath(input.c_str());
+      if( pathType == 2 || pathType == 4 ) {
+        printf("\nSpecified input is a directory but should be a file: %s", input.c_str());
+        quit();
+      }
+      if( pathType == 3 ) {
+        printf("\nSpecified input file does not exist: %s", input.c_str());
+        quit();
+      }
+      if( pathType == 0 ) {
+        printf("\nThere is a problem with the specified input file: %s", input.c_str());
+        quit();
+      }
+      if( input.lastSlashPos() >= 0 ) {
+        inputPath += input.c_str();
+        inputPath.keepPath();
+        input.keepFilename();
+      }
     }
 
     // Separate paths from output filename/directory name
-    if( output.strsize() > 0 ) {
+    if( output.strsize() > 0 && !stdoutOutput ) {
       pathType = examinePath(output.c_str());
       if( pathType == 1 || pathType == 3 ) { //is an existing file, or looks like a file
         if( output.lastSlashPos() >= 0 ) {
@@ -356,17 +664,74 @@ auto processCommandLine(int argc, char **argv) -> int {
     }
 
     Mode mode = whattodo == DoCompress ? COMPRESS : DECOMPRESS;
+    const bool streaming = mode == COMPRESS && (stdinInput || stdoutOutput); // the content size or the archive position is unknown
+
+    if( stdinInput && output.strsize() == 0 ) {
+      quit(mode == COMPRESS ? "An archive name (or - for stdout) is required when compressing stdin."
+                            : "An output file name (or - for stdout) is required when the archive is read from stdin.");
+    }
+    if( whattodo == DoCompare && stdoutOutput ) {
+      quit("The archive content can be compared only to a file.");
+    }
+    if( streaming && (blockSize != 0 || threads != 0 || snapshotInterval != 0) ) {
+      quit("Streams (-) are compressed as a single stream: -block, -threads and -snapshot can't be used.");
+    }
+    if( mode == COMPRESS && threads != 0 && blockSize == 0 ) {
+      blockSize = DEFAULT_BLOCK_SIZE;
+    }
+    if( mode == DECOMPRESS && blockSize != 0 ) {
+      quit("The block size is taken from the archive, -block may be used only for compression.");
+    }
+    if( threads == 0 ) {
+      threads = 1;
+    }
+    if( rangeLength != 0 && whattodo != DoExtract ) {
+      quit("The -range switch may be used only for extraction.");
+    }
+    if( snapshotInterval != 0 && (mode != COMPRESS || blockSize != 0) ) {
+      quit("The -snapshot switch may be used only for compression without -block or -threads.");
+    }
+    if( shared.asyncIo && blockSize != 0 ) {
+      quit("The -async switch may be used only without -block or -threads.");
+    }
+    if( memBudget != 0 && mode != COMPRESS ) {
+      quit("The -mem switch may be used only for compression: extraction uses the memory stored in the archive.");
+    }
+    uint8_t options = blockSize != 0 ? OPTION_BLOCKS : streaming ? OPTION_STREAM : 0;
+    if( prefault ) { // the threads of the machine are shared by the models of the workers
+      const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1U);
+      shared.prefaultThreads = std::max(hardwareThreads / (blockSize != 0 ? threads : 1), 1U);
+    }
+    if( shared.numaPolicy == NumaPolicy::Local && blockSize == 0 && numaNodeCount() > 1 ) { // the workers of -block pin themselves
+      shared.numaNode = numaCurrentNode();
+      numaPinThread(shared.numaNode);
+    }
 
 
-    FileName fn(inputPath.c_str());
-    fn += input.c_str();
-    getFileSize(fn.c_str()); // Does file exist? Is it readable? (we don't actually need the file size now)
+    uint64_t inputSize = 0; //0: unknown (stdin)
+    if( !stdinInput ) {
+      FileName fn(inputPath.c_str());
+      fn += input.c_str();
+      inputSize = getFileSize(fn.c_str()); // Does file exist? Is it readable?
+    }
+    if( mode == COMPRESS && (autoSize || memBudget != 0) ) {
+      sizeModelMemory<simd>(&shared, autoSize, blockSize != 0 ? std::min(inputSize, blockSize) : inputSize, blockSize, memBudget, threads);
+    }
 
-    FileDisk archive;  // compressed file
+    FileMapped archive;  // compressed file
+    AsyncReader archiveReader(&archive);
+    AsyncWriter archiveWriter(&archive);
+    File *archiveIo = &archive; // the archive as seen by the coder: it may be read/written on a separate thread
     uint64_t fSize{};
+    uint64_t archiveEnd{}; // archive size when extracting from a file
 
     if( mode == DECOMPRESS ) {
       archive.open(archiveName.c_str(), true);
+      if( !stdinInput ) { // for the progress of solid archives
+        archive.setEnd();
+        archiveEnd = archive.curPos();
+        archive.setpos(0);
+      }
       // Verify archive header, get level and options
       int len = static_cast<int>(strlen(PROGNAME));
       for( int i = 0; i < len; i++ ) {
@@ -375,19 +740,46 @@ auto processCommandLine(int argc, char **argv) -> int {
           quit();
         }
       }
+      const int version = archive.getchar();
+      if( version != ARCHIVE_VERSION ) {
+        if( version != EOF && (version & LEVEL_MASK) != 0 ) { // the level byte of an archive without a version
+          printf("%s was created by an earlier version of %s: its format is no longer supported.", archiveName.c_str(), PROGNAME);
+        } else {
+          printf("%s was created by another version of %s: its format is not supported.", archiveName.c_str(), PROGNAME);
+        }
+        quit();
+      }
 
-      c = archive.getchar();
-      uint8_t level = static_cast<uint8_t>(c);
-      if (level < 1 || level > 12) {
+      if( !shared.readLevel(&archive, options) || (options != 0 && options != OPTION_BLOCKS && options != OPTION_STREAM) ) {
         quit("Unexpected compression level setting in archive");
       }
-      shared.init(level);
-      fSize = archive.getVLI();
+      if( (options & OPTION_STREAM) == 0 ) { // streams have no content size in the header
+        fSize = archive.getVLI();
+      }
+      if( (options & OPTION_BLOCKS) != 0 ) {
+        blockSize = archive.getVLI();
+        if( blockSize == 0 ) {
+          quit("Unexpected block size in archive");
+        }
+        if( stdinInput && rangeOffset >= blockSize ) {
+          quit("The blocks before the -range offset can be skipped only when the archive is a file.");
+        }
+      }
+      if( (options & OPTION_STREAM) != 0 ) {
+        // the content size is known only at the end of the stream: the range is checked during extraction
+      } else if( rangeLength == 0 ) {
+        rangeLength = fSize;
+      } else if( rangeOffset >= fSize ) {
+        printf("The range offset is beyond the end of the content (%" PRIu64 " bytes).", fSize);
+        quit();
+      } else if( rangeLength > fSize - rangeOffset ) {
+        rangeLength = fSize - rangeOffset;
+      }
     }
 
     if( verbose ) {
       printCommand(whattodo);
-      printOptions(&shared);
+      printOptions(&shared, planMemory<simd>(shared.mem, blockSize), blockSize, threads, snapshotInterval);
     }
     printf("\n");
 
@@ -396,9 +788,15 @@ auto processCommandLine(int argc, char **argv) -> int {
       { //single file mode
         printf("Creating archive %s...\n", archiveName.c_str());
       }
+      if( !stdoutOutput && snapshotInterval == 0 ) { // the snapshots of an earlier archive of the same name don't belong to this one
+        FileName snapshotsName(archiveName.c_str());
+        snapshotsName += SNAPSHOT_EXTENSION;
+        remove(snapshotsName.c_str());
+      }
       archive.create(archiveName.c_str());
       archive.append(PROGNAME);
-      archive.putChar(shared.level);
+      archive.putChar(ARCHIVE_VERSION);
+      shared.writeLevel(&archive, options);
     }
 
     // When no output filename is specified we must construct it from the supplied archive filename
@@ -413,79 +811,203 @@ auto processCommandLine(int argc, char **argv) -> int {
       }
     }
 
-    Encoder en(&shared, mode, &archive);
-    uint64_t contentSize = 0;
-    uint64_t totalSize = 0;
-
-    if( mode == COMPRESS ) {
-      uint64_t start = en.size(); //header size (=8)
-      if( verbose ) {
-        printf("Writing header : %" PRIu64 " bytes\n", start);
+    if( shared.asyncIo && (options & OPTION_BLOCKS) == 0 ) {
+      if( mode == COMPRESS ) {
+        archiveWriter.start();
+        archiveIo = &archiveWriter;
+      } else {
+        archiveReader.start();
+        archiveIo = &archiveReader;
       }
-      totalSize += start;
     }
 
-    // Compress or decompress files
-    if( mode == COMPRESS ) {
-      if( !shared.toScreen ) { //we need a minimal feedback when redirected
-        fprintf(stderr, "Output is redirected - only minimal feedback is on screen\n");
+    if( (options & OPTION_BLOCKS) != 0 ) { // independent blocks: each worker has its own Encoder
+      if( mode == COMPRESS ) {
+        if( !shared.toScreen ) { //we need a minimal feedback when redirected
+          fprintf(stderr, "Output is redirected - only minimal feedback is on screen\n");
+        }
+        FileName fn;
+        fn += inputPath.c_str();
+        fn += input.c_str();
+        const char *fName = fn.c_str();
+        fSize = getFileSize(fName);
+        archive.putVLI(fSize);
+        archive.putVLI(blockSize);
+        if( !shared.toScreen ) { //we need a minimal feedback when redirected
+          fprintf(stderr, "\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
+        }
+        printf("\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
+        const uint64_t start = archive.curPos();
+        compressFileBlocks<simd>(&shared, fName, fSize, &archive, blockSize, threads);
+        printf("-----------------------\n");
+        printf("Total input size     : %" PRIu64 "\n", fSize);
+        if( verbose ) {
+          printf("Blocks               : %" PRIu64 "\n", (fSize + blockSize - 1) / blockSize);
+          printf("Header bytes         : %" PRIu64 "\n", start);
+        }
+        printf("Total archive size   : %" PRIu64 "\n", archive.curPos());
+        printf("\n");
+      } else if( whattodo == DoExtract || whattodo == DoCompare ) {
+        FMode fMode = whattodo == DoExtract ? FDECOMPRESS : FCOMPARE;
+        FileName fn;
+        fn += outputPath.c_str();
+        fn += output.c_str();
+        const char *fName = fn.c_str();
+        decompressFileBlocks<simd>(&shared, fName, fMode, &archive, fSize, blockSize, threads, rangeOffset, rangeLength);
       }
-      FileName fn;
-      fn += inputPath.c_str();
-      fn += input.c_str();
-      const char *fName = fn.c_str();
-      fSize = getFileSize(fName);
-      archive.putVLI(fSize);
-      if( !shared.toScreen ) { //we need a minimal feedback when redirected
-        fprintf(stderr, "\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
-      }
-      printf("\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
-      compressfile(&shared, fName, fSize, en, verbose);
-      totalSize += fSize + 4; //4: file size information
-      contentSize += fSize;
-
-      auto preFlush = en.size();
-      en.flush();
-      totalSize += en.size() - preFlush; //we consider padding bytes as auxiliary bytes
-      printf("-----------------------\n");
-      printf("Total input size     : %" PRIu64 "\n", contentSize);
+      archive.close();
+      programChecker->print();
       if( verbose ) {
-        printf("Total metadata bytes : %" PRIu64 "\n", totalSize - contentSize);
+        programChecker->printMemory(planMemory<simd>(shared.mem, blockSize), threads);
       }
-      printf("Total archive size   : %" PRIu64 "\n", en.size());
-      printf("\n");
-
-    } else { //decompress
-      if( whattodo == DoExtract || whattodo == DoCompare ) {
+    } else if( (options & OPTION_STREAM) != 0 ) { // frames of unknown count: the Encoder reads/writes them through memory
+      if( mode == COMPRESS ) {
+        FileName fn;
+        fn += inputPath.c_str();
+        fn += input.c_str();
+        FileMapped in;
+        in.open(fn.c_str(), true);
+        AsyncReader asyncIn(&in);
+        if( shared.asyncIo ) {
+          asyncIn.start();
+        }
+        printf("\nFilename: %s\n", fn.c_str());
+        uint64_t archiveSize = strlen(PROGNAME) + 1 + ((shared.levelByte() & OPTION_MEMORY) != 0 ? 2 : 1); // header
+        const uint64_t contentSize = compressStream<simd>(&shared, shared.asyncIo ? static_cast<File *>(&asyncIn) : &in, archiveIo, archiveSize);
+        asyncIn.close();
+        in.close();
+        printf("-----------------------\n");
+        printf("Total input size     : %" PRIu64 "\n", contentSize);
+        printf("Total archive size   : %" PRIu64 "\n", archiveSize);
+        printf("\n");
+      } else if( whattodo == DoExtract || whattodo == DoCompare ) {
         FMode fMode = whattodo == DoExtract ? FDECOMPRESS : FCOMPARE;
         FileName fn;
         fn += outputPath.c_str();
         fn += output.c_str();
-        const char *fName = fn.c_str();
-        decompressFile(&shared, fName, fMode, en, fSize);
+        decompressStream<simd>(&shared, fn.c_str(), fMode, archiveIo, rangeOffset, rangeLength);
       }
-    }
+      closeArchive(&archive, &archiveReader, &archiveWriter, verbose && shared.asyncIo);
+      programChecker->print();
+      if( verbose ) {
+        programChecker->printMemory(planMemory<simd>(shared.mem, 0), 1);
+      }
+    } else {
+      const double setupStart = programChecker->getRuntime();
+      const uint64_t setupFaults = ProgramChecker::getPageFaults();
+      Encoder<simd> en(&shared, mode, archiveIo);
+      const uint64_t codingFaults = ProgramChecker::getPageFaults();
+      if( verbose ) {
+        printf("Model setup    : %1.3f sec, %" PRIu64 " page faults", programChecker->getRuntime() - setupStart, codingFaults - setupFaults);
+        if( shared.prefaultThreads != 0 ) {
+          printf(" (pre-faulted, %u threads)", shared.prefaultThreads);
+        }
+        printf("\n");
+      }
+      uint64_t contentSize = 0;
+      uint64_t totalSize = 0;
+      FileDisk snapshots; // -snapshot: finished when the archive is complete
+      if( mode == DECOMPRESS && !stdinInput ) { // the progress is relative to the archive size
+        en.setStatusRange(0.0, static_cast<float>(archiveEnd));
+      }
+
+      if( mode == COMPRESS ) {
+        uint64_t start = en.size(); //header size (=8)
+        if( verbose ) {
+          printf("Writing header : %" PRIu64 " bytes\n", start);
+        }
+        totalSize += start;
+      }
+
+      // Compress or decompress files
+      if( mode == COMPRESS ) {
+        if( !shared.toScreen ) { //we need a minimal feedback when redirected
+          fprintf(stderr, "Output is redirected - only minimal feedback is on screen\n");
+        }
+        FileName fn;
+        fn += inputPath.c_str();
+        fn += input.c_str();
+        const char *fName = fn.c_str();
+        fSize = getFileSize(fName);
+        archiveIo->putVLI(fSize);
+        if( !shared.toScreen ) { //we need a minimal feedback when redirected
+          fprintf(stderr, "\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
+        }
+        printf("\nFilename: %s (%" PRIu64 " bytes)\n", fName, fSize);
+        if( snapshotInterval != 0 ) {
+          FileName snapshotsName(archiveName.c_str());
+          snapshotsName += SNAPSHOT_EXTENSION;
+          snapshots.create(snapshotsName.c_str());
+        }
+        compressfile(&shared, fName, fSize, en, verbose, snapshotInterval != 0 ? &snapshots : nullptr, snapshotInterval);
+        totalSize += fSize + 4; //4: file size information
+        contentSize += fSize;
 
-    archive.close();
-    programChecker->print();
+        auto preFlush = en.size();
+        en.flush();
+        totalSize += en.size() - preFlush; //we consider padding bytes as auxiliary bytes
+        printf("-----------------------\n");
+        printf("Total input size     : %" PRIu64 "\n", contentSize);
+        if( verbose ) {
+          printf("Total metadata bytes : %" PRIu64 "\n", totalSize - contentSize);
+        }
+        printf("Total archive size   : %" PRIu64 "\n", en.size());
+        printf("\n");
 
-    if(false) // need to see hashtable statistics?
-      en.predictorMain.normalModel.cm.print();
+      } else { //decompress
+        if( whattodo == DoExtract || whattodo == DoCompare ) {
+          FMode fMode = whattodo == DoExtract ? FDECOMPRESS : FCOMPARE;
+          FileName fn;
+          fn += outputPath.c_str();
+          fn += output.c_str();
+          const char *fName = fn.c_str();
+          bool hasSnapshots = false;
+          if( rangeOffset != 0 && !stdinInput ) {
+            FileName snapshotsName(archiveName.c_str());
+            snapshotsName += SNAPSHOT_EXTENSION;
+            hasSnapshots = snapshots.open(snapshotsName.c_str(), false);
+          }
+          decompressFile(&shared, fName, fMode, en, rangeOffset, rangeLength, fSize, hasSnapshots ? &snapshots : nullptr, archiveName.c_str());
+          if( hasSnapshots ) {
+            snapshots.close();
+          }
+        }
+      }
 
-    if (false) {
-      //printf("sm0\n");
-      //normalModel.smOrder0.print();
-      //printf("sm0\n");
-      //normalModel.smOrder1.print();
-      //printf("sm0\n");
-      //normalModel.smOrder2.print();
-      for (int i = 0; i < 6; i++) {
-        printf("cm1-rm%d\n", i);
-        //en.predictorMain.normalModel.cm.runMap[i].print();
+      closeArchive(&archive, &archiveReader, &archiveWriter, verbose && shared.asyncIo);
+      if( mode == COMPRESS && snapshotInterval != 0 ) {
+        finishSnapshots(&snapshots, archiveName.c_str());
+        if( verbose ) {
+          printf("Snapshots size       : %" PRIu64 "\n", snapshots.curPos());
+        }
+        snapshots.close();
+      }
+      if( verbose ) {
+        printf("Page faults while coding: %" PRIu64 "\n", ProgramChecker::getPageFaults() - codingFaults);
+      }
+      programChecker->print();
+      if( verbose ) {
+        programChecker->printMemory(planMemory<simd>(shared.mem, 0), 1);
       }
-      for (int i = 0; i < 6; i++) {
-        printf("cm1-sm%d\n", i);
-        //en.predictorMain.normalModel.cm.stateMap[i].print();
+
+      if(false) // need to see hashtable statistics?
+        en.predictorMain.normalModel.cm.print();
+
+      if (false) {
+        //printf("sm0\n");
+        //normalModel.smOrder0.print();
+        //printf("sm0\n");
+        //normalModel.smOrder1.print();
+        //printf("sm0\n");
+        //normalModel.smOrder2.print();
+        for (int i = 0; i < 6; i++) {
+          printf("cm1-rm%d\n", i);
+          //en.predictorMain.normalModel.cm.runMap[i].print();
+        }
+        for (int i = 0; i < 6; i++) {
+          printf("cm1-sm%d\n", i);
+          //en.predictorMain.normalModel.cm.stateMap[i].print();
+        }
       }
     }
   }
@@ -497,6 +1019,58 @@ auto processCommandLine(int argc, char **argv) -> int {
   return 0;
 }
 
+#ifdef FAT_BINARY
+
+auto processCommandLine_x86_64_v1(int argc, char **argv) -> int;
+auto processCommandLine_x86_64_v2(int argc, char **argv) -> int;
+auto processCommandLine_x86_64_v3(int argc, char **argv) -> int;
+
+/**
+ * Runs the variant of the program compiled for the highest x86-64 microarchitecture level of the CPU
+ */
+auto processCommandLine(int argc, char **argv) -> int {
+  switch( isaLevelDetect()) {
+    case 3:
+      return processCommandLine_x86_64_v3(argc, argv);
+    case 2:
+      return processCommandLine_x86_64_v2(argc, argv);
+    default:
+      return processCommandLine_x86_64_v1(argc, argv);
+  }
+}
+
+#else
+
+/**
+ * Selects the highest or the user selected vectorization mode once, and runs the program compiled for it
+ */
+#ifdef ISA_VARIANT
+__attribute__((externally_visible)) // the entry point of the variant (see build/build-linux.sh)
+#endif
+auto processCommandLine(int argc, char **argv) -> int {
+  int simdIset = getSelectedSimdIset(argc, argv);
+  if( simdIset == -1 ) {
+    simdIset = simdDetect();
+  }
+  if( simdIset == 11 ) {
+    return processCommandLine<SIMDType::SIMD_NEON>(argc, argv);
+  }
+  if( simdIset >= 9 ) {
+    return processCommandLine<SIMDType::SIMD_AVX2>(argc, argv);
+  }
+  if( simdIset >= 5 ) {
+    return processCommandLine<SIMDType::SIMD_SSSE3>(argc, argv);
+  }
+  if( simdIset >= 3 ) {
+    return processCommandLine<SIMDType::SIMD_SSE2>(argc, argv);
+  }
+  return processCommandLine<SIMDType::SIMD_NONE>(argc, argv);
+}
+
+#endif //FAT_BINARY
+
+#ifndef ISA_VARIANT
+
 #ifdef WINDOWS
 #include "shellapi.h"
 #pragma comment(lib,"shell32.lib")
@@ -537,3 +1111,5 @@ auto main(int argc, char **argv) -> int {
   return processCommandLine(argc, argv);
 #endif
 }
+
+#endif //ISA_VARIANT
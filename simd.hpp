@@ -117,4 +117,49 @@ static auto simdDetect() -> int {
 #endif
 }
 
+#ifdef FAT_BINARY
+/* Returns the highest x86-64 microarchitecture level supported by the system (the variants of a fat binary, see build-linux.sh) as
+0: not x86-64
+1: x86-64 (SSE2)
+2: x86-64-v2 (+ SSE3, SSSE3, SSE4.1, SSE4.2, POPCNT, CMPXCHG16B)
+3: x86-64-v3 (+ AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT, MOVBE)
+*/
+static auto isaLevelDetect() -> int {
+#if defined(__ARM_FEATURE_SIMD32) || defined(__ARM_NEON) || !(defined(__x86_64__) || defined(_M_X64))
+  return 0;
+#else
+  const int simdIset = simdDetect();
+  if( simdIset < 7 ) {
+    return 1;
+  }
+  int cpuidResult[4] = {0, 0, 0, 0};
+  cpuid(cpuidResult, 1);
+  if((cpuidResult[2] & (1U << 13U)) == 0 || (cpuidResult[2] & (1U << 23U)) == 0 ) {
+    return 1; //no CMPXCHG16B or POPCNT
+  }
+  //x86-64-v2: OK
+  if( simdIset < 9 ) {
+    return 2;
+  }
+  if((cpuidResult[2] & (1U << 12U)) == 0 || (cpuidResult[2] & (1U << 22U)) == 0 || (cpuidResult[2] & (1U << 29U)) == 0 ) {
+    return 2; //no FMA, MOVBE or F16C
+  }
+  cpuid(cpuidResult, 7);
+  if((cpuidResult[1] & (1U << 3U)) == 0 || (cpuidResult[1] & (1U << 8U)) == 0 ) {
+    return 2; //no BMI1 or BMI2
+  }
+  cpuid(cpuidResult, 0x80000000);
+  if( static_cast<uint32_t>(cpuidResult[0]) < 0x80000001U ) {
+    return 2;
+  }
+  cpuid(cpuidResult, 0x80000001);
+  if((cpuidResult[2] & (1U << 5U)) == 0 ) {
+    return 2; //no LZCNT
+  }
+  //x86-64-v3: OK
+  return 3;
+#endif
+}
+#endif //FAT_BINARY
+
 #endif //PAQ8PX_SIMD_HPP
@@ -0,0 +1,42 @@
+// Checks that the touched bytes of ProgramChecker count the pages written to large tables: tables allocated by
+// LargePageAllocation (huge pages, or 2 MB aligned mappings) of a whole number of pages and of a size that ends
+// within a page, and a heap allocated table. Exits with 1 when a check fails.
+//
+// Build (from this folder):
+//   g++ -O2 -std=gnu++1z TouchedBytesTest.cpp ../Allocation.cpp ../ProgramChecker.cpp ../String.cpp -o touchedbytestest
+// Run:
+//   ./touchedbytestest
+
+#include "../Array.hpp"
+#include <cstdio>
+#include <cstring>
+
+static auto check(const char *name, const MemoryComponent component, const uint64_t written) -> bool {
+  const uint64_t touched = ProgramChecker::getInstance()->touchedBytes(component);
+  const bool ok = touched >= (written & ~UINT64_C(4095));
+  printf("%-26s written %9" PRIu64 ", touched %9" PRIu64 ": %s\n", name, written, touched, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+auto main() -> int {
+  bool ok = true;
+  {
+    const uint64_t bytes = UINT64_C(8) << 20U;
+    Array<uint8_t, 64, LargePageAllocation> table(bytes, MemoryComponent::HashTable);
+    memset(&table[0], 1, bytes);
+    ok &= check("large pages, 8 MB", MemoryComponent::HashTable, bytes);
+  }
+  {
+    const uint64_t bytes = (UINT64_C(3) << 20U) + 100;
+    Array<uint8_t, 64, LargePageAllocation> table(bytes, MemoryComponent::Order2Map);
+    memset(&table[0], 1, bytes);
+    ok &= check("large pages, 3 MB + 100", MemoryComponent::Order2Map, bytes);
+  }
+  {
+    const uint64_t bytes = UINT64_C(1) << 20U;
+    Array<uint8_t, 64> table(bytes, MemoryComponent::Mixer);
+    memset(&table[0], 1, bytes);
+    ok &= check("heap, 1 MB", MemoryComponent::Mixer, bytes);
+  }
+  return ok ? 0 : 1;
+}